@@ -0,0 +1,83 @@
+/*
+ * analysis.c — предрасчёт по уровню, общий для решателя и генератора.
+ *
+ * Зависит только от стен и целей, поэтому считается один раз на уровень:
+ *   - расстояние в толчках от каждой клетки до каждой цели;
+ *   - битовая карта мёртвых клеток — клеток, с которых ящик нельзя
+ *     дотолкать ни до одной цели (углы, ниши, клетки вдоль стен без целей).
+ */
+
+#include "analysis.h"
+#include "bitboard.h"
+#include <string.h>
+
+static const int ADX[4] = {0, 0, -1, 1};
+static const int ADY[4] = {-1, 1, 0, 0};
+
+/*
+ * BuildPushTable — обратный BFS от каждой цели: ящики «тянутся» назад.
+ *
+ * Ящик мог попасть в клетку c толчком в направлении d из клетки
+ * p = c - d, если и p, и клетка игрока p - d — не стены. Другие ящики и
+ * достижимость игрока не учитываются, поэтому расстояние — нижняя оценка
+ * реального числа толчков, но в отличие от Manhattan оно знает о стенах.
+ * PUSH_DIST_INF — с клетки цель не достичь.
+ *
+ * Клетка пола, недостижимая обратным BFS ни от одной цели, помечается
+ * мёртвой: ящик на ней — гарантированный дедлок. Сюда попадают не только
+ * углы, но и целые участки вдоль стен, где нет целей.
+ */
+void BuildPushTable(const Level *level, PushTable *pt)
+{
+    int n = level->num_boxes;
+    pt->num_goals = n;
+    BBClear(&pt->dead);
+
+    for (int g = 0; g < n; g++)
+    {
+        unsigned short *dist = pt->dist[g];
+        unsigned short queue[MAX_FIELD * MAX_FIELD];
+        int head = 0, tail = 0;
+
+        for (int i = 0; i < MAX_FIELD * MAX_FIELD; i++)
+            dist[i] = PUSH_DIST_INF;
+        int goal = level->goals[g].y * MAX_FIELD + level->goals[g].x;
+        dist[goal] = 0;
+        queue[tail++] = (unsigned short)goal;
+
+        while (head < tail)
+        {
+            int c = queue[head++];
+            int cx = c % MAX_FIELD;
+            int cy = c / MAX_FIELD;
+            for (int d = 0; d < 4; d++)
+            {
+                int bx = cx - ADX[d]; // откуда приехал ящик
+                int by = cy - ADY[d];
+                int px = bx - ADX[d]; // где стоял игрок
+                int py = by - ADY[d];
+                if (px < 0 || px >= level->width || py < 0 || py >= level->height) continue;
+                if (bx < 0 || bx >= level->width || by < 0 || by >= level->height) continue;
+                if (level->cells[by][bx] == CELL_WALL || level->cells[py][px] == CELL_WALL) continue;
+                int b = by * MAX_FIELD + bx;
+                if (dist[b] != PUSH_DIST_INF) continue;
+                dist[b] = (unsigned short)(dist[c] + 1);
+                queue[tail++] = (unsigned short)b;
+            }
+        }
+    }
+
+    // Мёртвые клетки: пол, с которого не доехать ни до одной цели
+    for (int y = 0; y < level->height; y++)
+    {
+        for (int x = 0; x < level->width; x++)
+        {
+            if (level->cells[y][x] == CELL_WALL) continue;
+            int pos = y * MAX_FIELD + x;
+            int alive = 0;
+            for (int g = 0; g < n && !alive; g++)
+                if (pt->dist[g][pos] != PUSH_DIST_INF) alive = 1;
+            if (!alive) BBSet(&pt->dead, pos);
+        }
+    }
+}
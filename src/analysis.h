@@ -0,0 +1,14 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "types.h"
+
+void BuildPushTable(const Level *level, PushTable *pt);
+
+// клетка pos (y * MAX_FIELD + x) мёртвая: ящик с неё не доедет ни до одной цели
+static inline int IsDeadSquare(const PushTable *pt, int pos)
+{
+    return (int)((pt->dead.w[pos >> 6] >> (pos & 63)) & 1);
+}
+
+#endif
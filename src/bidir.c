@@ -0,0 +1,318 @@
+/*
+ * bidir.c — двунаправленный решатель: поиск в ширину толчками от старта и
+ * притягиваниями от целевых состояний одновременно.
+ *
+ * Прямая сторона раскрывает толчки (ExpandState), обратная — притягивания
+ * (ExpandPulls), начиная со всех целевых состояний (GoalStates: ящики на
+ * целях, игрок в любой области рядом с ящиком). Обе стороны используют
+ * одно представление состояния, поэтому встречаются через общий индекс:
+ * один HashSet по ключу Zobrist на общий NodePool, в узле помечена
+ * сторона (side). Если потомок одной стороны уже есть в индексе с
+ * другой стороны, найдена встреча: путь старт → встреча → цель.
+ *
+ * Обход послойный: каждый раз целиком раскрывается следующий слой той
+ * стороны, у которой фронт меньше. Все толчки стоят одинаково, поэтому
+ * после первого слоя, давшего встречу, минимальная из найденных встреч
+ * оптимальна по числу толчков. Каждая сторона проходит примерно половину
+ * глубины решения, поэтому на длинных уровнях фронты гораздо меньше, чем
+ * у одностороннего поиска той же глубины.
+ */
+
+#include "solver.h"
+#include "search.h"
+#include "nodes.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Наибольшее число целевых состояний (областей игрока у собранных ящиков). */
+#define MAX_GOAL_STATES 64
+
+/* LayerAdd — дописывает индекс узла в слой; 0 — нет памяти. */
+static int LayerAdd(IndexStack *layer, int node_idx)
+{
+    if (layer->size >= layer->capacity)
+    {
+        int new_cap = layer->capacity ? layer->capacity * 2 : 1024;
+        int *tmp = (int *)realloc(layer->idx, sizeof(int) * new_cap);
+        if (!tmp) return 0;
+        layer->idx = tmp;
+        layer->capacity = new_cap;
+    }
+    layer->idx[layer->size++] = node_idx;
+    return 1;
+}
+
+/*
+ * AddNode — кладёт состояние в общий пул и индекс (slot — ячейка от
+ * HashSetFind). Возвращает индекс узла или -1, если закончилась память.
+ */
+static int AddNode(NodePool *pool, HashSet *index, const SearchChild *ch, int side,
+                   int parent, int g, int nb, uint32_t slot)
+{
+    AStarNode node;
+    node.key = ch->key;
+    node.parent_owner = 0;
+    node.parent = parent;
+    node.direction = (signed char)ch->direction;
+    node.side = (unsigned char)side;
+    node.g = g;
+    node.f = g;
+
+    int idx = PoolAdd(pool, &node, &ch->state);
+    if (idx < 0) return -1;
+    if (index->count * 2 >= index->capacity) // load factor > 0.5
+    {
+        if (!HashSetGrow(index)) return -1;
+        HashSetFind(index, pool, ch->key, &ch->state, nb, &slot);
+    }
+    HashSetPut(index, slot, ch->key, idx);
+    return idx;
+}
+
+/*
+ * BuildMeetPath — собирает цепочку толчков через встречу: узел fwd прямой
+ * стороны, толчок в сторону dir, узел bwd обратной стороны. Прямая часть
+ * разворачивается по parent от fwd к старту, обратная — по parent от bwd
+ * к цели; в узлах обратной стороны direction — толчок к родителю.
+ */
+static bool BuildMeetPath(const SearchContext *ctx, const NodePool *pool,
+                          int fwd, int dir, int bwd, Solver *solver)
+{
+    int num_pushes = PoolNode(pool, fwd)->g + 1 + PoolNode(pool, bwd)->g;
+    PackedState *path = (PackedState *)malloc(sizeof(PackedState) * (num_pushes + 1));
+    int *dirs = (int *)malloc(sizeof(int) * (num_pushes + 1));
+    bool ok = false;
+    if (path && dirs)
+    {
+        int k = PoolNode(pool, fwd)->g;
+        for (int idx = fwd; idx >= 0; idx = PoolNode(pool, idx)->parent, k--)
+        {
+            NodeState(ctx, pool, idx, &path[k]);
+            dirs[k] = PoolNode(pool, idx)->direction;
+        }
+        k = PoolNode(pool, fwd)->g + 1;
+        int next_dir = dir;
+        for (int idx = bwd; idx >= 0; idx = PoolNode(pool, idx)->parent, k++)
+        {
+            NodeState(ctx, pool, idx, &path[k]);
+            dirs[k] = next_dir;
+            next_dir = PoolNode(pool, idx)->direction;
+        }
+        ok = BuildMoves(ctx, path, dirs, num_pushes, solver);
+    }
+    free(path);
+    free(dirs);
+    return ok;
+}
+
+/* LayersBytes — память под индексы слоёв (учитывается в лимите памяти). */
+static long long LayersBytes(const IndexStack *layer, const IndexStack *next)
+{
+    return (long long)sizeof(int) * (layer[0].capacity + layer[1].capacity + next->capacity);
+}
+
+/*
+ * RunBidirectional — двунаправленный поиск в ширину; режим SOLVER_BIDIR
+ * у SolveLevelEx. Найденное решение оптимально по числу толчков. Если
+ * фронт одной из сторон опустел без встречи, уровень нерешаем.
+ */
+SolveResult RunBidirectional(const Level *level, Solver *solver, const SolverOptions *opt,
+                             SolverStats *stats)
+{
+    int nb = level->num_boxes;
+    SolveResult result = SOLVE_OUT_OF_MEMORY;
+    SolverStats st = {0}; // отсечения — только прямой стороны
+    double t_start = NowMs(), t_init = t_start, t_search = t_start;
+
+    SearchBudget budget;
+    InitBudget(&budget, opt, MAX_ITERATIONS);
+
+    NodePool *pool = NULL;
+    HashSet *index = NULL;
+    SearchContext *ctx = (SearchContext *)malloc(sizeof(SearchContext));
+    IndexStack layer[2] = {{0}}, next = {0};
+    int depth[2] = {0, 0};
+    long long iterations = 0;
+    // Лучшая встреча: узел прямой стороны, толчок, узел обратной стороны
+    int best = -1, meet_fwd = -1, meet_dir = -1, meet_bwd = -1;
+
+    if (!ctx) goto cleanup;
+    InitSearch(level, ctx, opt->memo, 0); // эвристика нужна только ради H_INF
+    pool = CreateNodePool(NODES_MAX_CAP, !ctx->ranks.exact);
+    index = CreateHashSet(InitialHashCap(budget.max_bytes, 1));
+    if (!pool || !index)
+        goto cleanup;
+    t_init = t_search = NowMs();
+    if (StateHeuristic(ctx, &ctx->root) == H_INF)
+    {
+        result = SOLVE_UNSOLVABLE; // ящики не развести по целям
+        goto cleanup;
+    }
+
+    // Старт уже решён: ноль толчков. Проверяется до корней — игрок может
+    // стоять в области, которой нет среди целевых состояний (GoalStates)
+    if (IsGoalState(ctx, &ctx->root))
+    {
+        int no_dir = -1;
+        if (BuildMoves(ctx, &ctx->root, &no_dir, 0, solver))
+        {
+            result = SOLVE_FOUND;
+            st.solutions = 1;
+        }
+        goto cleanup;
+    }
+
+    // Корни: старт — прямая сторона, все целевые состояния — обратная
+    {
+        SearchChild start = {ctx->root, ctx->root_key, -1};
+        uint32_t slot;
+        HashSetFind(index, pool, start.key, &start.state, nb, &slot);
+        int idx = AddNode(pool, index, &start, 0, -1, 0, nb, slot);
+        if (idx < 0 || !LayerAdd(&layer[0], idx)) goto cleanup;
+
+        SearchChild goals[MAX_GOAL_STATES];
+        int num_goals = GoalStates(ctx, goals, MAX_GOAL_STATES);
+        for (int i = 0; i < num_goals; i++)
+        {
+            HashSetFind(index, pool, goals[i].key, &goals[i].state, nb, &slot);
+            idx = AddNode(pool, index, &goals[i], 1, -1, 0, nb, slot);
+            if (idx < 0 || !LayerAdd(&layer[1], idx)) goto cleanup;
+        }
+    }
+
+    SearchChild children[MAX_CHILDREN];
+    result = SOLVE_UNSOLVABLE; // если фронт опустеет без встречи
+    while (best < 0 && layer[0].size > 0 && layer[1].size > 0)
+    {
+        // Раскрываем слой стороны с меньшим фронтом
+        int side = layer[0].size <= layer[1].size ? 0 : 1;
+        next.size = 0;
+
+        for (int i = 0; i < layer[side].size; i++)
+        {
+            if (iterations >= budget.max_nodes) { result = SOLVE_BUDGET; goto done; }
+
+            int cur_idx = layer[side].idx[i];
+            PackedState cur_state;
+            NodeState(ctx, pool, cur_idx, &cur_state);
+            uint64_t cur_key = PoolNode(pool, cur_idx)->key;
+            int cur_g = PoolNode(pool, cur_idx)->g;
+            iterations++;
+            if (iterations % PROGRESS_STEP == 0 &&
+                PollBudget(&budget, iterations, layer[side].size + next.size,
+                           depth[0] + depth[1], &result))
+                goto done; // отмена из UI или истёк срок
+
+            int n = side == 0 ? ExpandState(ctx, &cur_state, cur_key, children, &st.prune)
+                              : ExpandPulls(ctx, &cur_state, cur_key, children);
+            st.generated += n;
+            for (int c = 0; c < n; c++)
+            {
+                const SearchChild *ch = &children[c];
+                uint32_t slot;
+                int seen = HashSetFind(index, pool, ch->key, &ch->state, nb, &slot);
+                if (seen >= 0)
+                {
+                    // Своя сторона уже была здесь не позже (обход в ширину)
+                    if (PoolNode(pool, seen)->side == side) { st.duplicates++; continue; }
+
+                    // Встреча фронтов: запоминаем кратчайшую в этом слое
+                    int cost = cur_g + 1 + PoolNode(pool, seen)->g;
+                    if (best < 0 || cost < best)
+                    {
+                        best = cost;
+                        meet_dir = ch->direction;
+                        meet_fwd = side == 0 ? cur_idx : seen;
+                        meet_bwd = side == 0 ? seen : cur_idx;
+                    }
+                    continue;
+                }
+
+                // Прямая сторона: отсекаем расстановки, где ящики не развести по целям
+                if (side == 0 && StateHeuristic(ctx, &ch->state) == H_INF)
+                {
+                    st.pruned_h++;
+                    continue;
+                }
+
+                if (OverMemory(&budget, pool->bytes + index->bytes + LayersBytes(layer, &next) +
+                                        PoolGrowthBytes(pool) + HashSetGrowthBytes(index)))
+                {
+                    result = SOLVE_OUT_OF_MEMORY;
+                    goto done;
+                }
+                int idx = AddNode(pool, index, ch, side, cur_idx, cur_g + 1, nb, slot);
+                if (idx < 0 || !LayerAdd(&next, idx))
+                {
+                    result = SOLVE_OUT_OF_MEMORY;
+                    goto done;
+                }
+            }
+        }
+        if (next.size > st.open_peak) st.open_peak = next.size;
+
+        // Новый слой заменяет раскрытый
+        IndexStack tmp = layer[side];
+        layer[side] = next;
+        next = tmp;
+        depth[side]++;
+    }
+
+done:
+    t_search = NowMs();
+    if (best >= 0)
+    {
+        // Встреча найдена в последнем слое: он раскрыт целиком или
+        // прерван лимитом, но и тогда путь через встречу — решение
+        result = BuildMeetPath(ctx, pool, meet_fwd, meet_dir, meet_bwd, solver)
+               ? SOLVE_FOUND : SOLVE_OUT_OF_MEMORY;
+        if (result == SOLVE_FOUND)
+        {
+            st.solutions = 1;
+            st.pushes = st.lower_bound = best;
+        }
+    }
+
+    printf("[solver] bidir iterations=%lld  pool=%d  depth=%d+%d  freeze=%lld  corral=%lld  found=%s\n",
+           iterations, pool->count, depth[0], depth[1], st.prune.freeze, st.prune.corral,
+           best >= 0 ? "YES" : "NO");
+
+    st.expanded = iterations;
+    st.pool_peak = pool->count;
+    st.reallocs = pool->num_chunks;
+    st.rehashes = index->rehashes;
+    st.bytes = pool->bytes + index->bytes + LayersBytes(layer, &next);
+
+cleanup:
+    if (stats)
+    {
+        double t_end = NowMs();
+        st.init_ms = t_init - t_start;
+        st.search_ms = t_search - t_init;
+        st.path_ms = t_end - t_search;
+        if (ctx)
+        {
+            st.pdb_ms = ctx->pdb.build_ms;
+            st.pdb_bytes = ctx->pdb.bytes;
+        }
+        *stats = st;
+    }
+    free(layer[0].idx);
+    free(layer[1].idx);
+    free(next.idx);
+    FreeNodePool(pool);
+    FreeHashSet(index);
+    if (ctx) FreeSearch(ctx);
+    free(ctx);
+    return result;
+}
+
+/*
+ * SolveLevelBidirectional — двунаправленный поиск без дополнительных
+ * лимитов; true, если решение найдено.
+ */
+bool SolveLevelBidirectional(const Level *level, Solver *solver)
+{
+    SolverOptions opt = {.algorithm = SOLVER_BIDIR};
+    return SolveLevelEx(level, solver, &opt, NULL) == SOLVE_FOUND;
+}
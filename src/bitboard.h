@@ -0,0 +1,157 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include "types.h"
+
+/*
+ * Битовые карты поля: бит pos = y * MAX_FIELD + x. Поле 20×20 — 400 бит,
+ * CELL_WORDS = 7 слов по 64 бита. Сдвиг на 1 — соседняя клетка по
+ * горизонтали, на MAX_FIELD — по вертикали.
+ */
+
+static inline void BBClear(Bitboard *bb)
+{
+    for (int i = 0; i < CELL_WORDS; i++) bb->w[i] = 0;
+}
+
+static inline void BBSet(Bitboard *bb, int pos)
+{
+    bb->w[pos >> 6] |= 1ULL << (pos & 63);
+}
+
+static inline void BBReset(Bitboard *bb, int pos)
+{
+    bb->w[pos >> 6] &= ~(1ULL << (pos & 63));
+}
+
+static inline int BBTest(const Bitboard *bb, int pos)
+{
+    return (int)((bb->w[pos >> 6] >> (pos & 63)) & 1);
+}
+
+static inline int BBEqual(const Bitboard *a, const Bitboard *b)
+{
+    uint64_t diff = 0;
+    for (int i = 0; i < CELL_WORDS; i++) diff |= a->w[i] ^ b->w[i];
+    return diff == 0;
+}
+
+static inline int BBIsZero(const Bitboard *bb)
+{
+    uint64_t any = 0;
+    for (int i = 0; i < CELL_WORDS; i++) any |= bb->w[i];
+    return any == 0;
+}
+
+// число установленных битов
+static inline int BBCount(const Bitboard *bb)
+{
+    int n = 0;
+    for (int i = 0; i < CELL_WORDS; i++) n += __builtin_popcountll(bb->w[i]);
+    return n;
+}
+
+// индекс младшего установленного бита, -1 — карта пуста
+static inline int BBFirst(const Bitboard *bb)
+{
+    for (int i = 0; i < CELL_WORDS; i++)
+        if (bb->w[i]) return i * 64 + __builtin_ctzll(bb->w[i]);
+    return -1;
+}
+
+// извлекает и снимает младший установленный бит, -1 — карта пуста
+static inline int BBPop(Bitboard *bb)
+{
+    for (int i = 0; i < CELL_WORDS; i++)
+    {
+        if (bb->w[i])
+        {
+            int bit = __builtin_ctzll(bb->w[i]);
+            bb->w[i] &= bb->w[i] - 1;
+            return i * 64 + bit;
+        }
+    }
+    return -1;
+}
+
+// сдвиг к большим индексам на k бит (0 < k < 64)
+static inline Bitboard BBShl(const Bitboard *bb, int k)
+{
+    Bitboard r;
+    r.w[0] = bb->w[0] << k;
+    for (int i = 1; i < CELL_WORDS; i++)
+        r.w[i] = (bb->w[i] << k) | (bb->w[i - 1] >> (64 - k));
+    return r;
+}
+
+// сдвиг к меньшим индексам на k бит (0 < k < 64)
+static inline Bitboard BBShr(const Bitboard *bb, int k)
+{
+    Bitboard r;
+    for (int i = 0; i < CELL_WORDS - 1; i++)
+        r.w[i] = (bb->w[i] >> k) | (bb->w[i + 1] << (64 - k));
+    r.w[CELL_WORDS - 1] = bb->w[CELL_WORDS - 1] >> k;
+    return r;
+}
+
+/*
+ * BBStep — все клетки, соседние с bb в направлении d (0-3 = вверх/вниз/
+ * влево/вправо). Перенос через край строки отсекается масками столбцов.
+ */
+static inline Bitboard BBStep(const Bitboard *bb, int d, const BoardMasks *m)
+{
+    Bitboard r;
+    switch (d)
+    {
+    case 0: return BBShr(bb, MAX_FIELD);
+    case 1: return BBShl(bb, MAX_FIELD);
+    case 2:
+        r = BBShr(bb, 1);
+        for (int i = 0; i < CELL_WORDS; i++) r.w[i] &= m->not_last_col.w[i];
+        return r;
+    default:
+        r = BBShl(bb, 1);
+        for (int i = 0; i < CELL_WORDS; i++) r.w[i] &= m->not_first_col.w[i];
+        return r;
+    }
+}
+
+/*
+ * BBFloodFrom — заливка области free, связной с клетками seeds: волна
+ * расширяется во все четыре стороны сразу, по CELL_WORDS слов за шаг,
+ * пока не перестанет расти.
+ */
+static inline Bitboard BBFloodFrom(const Bitboard *free, const Bitboard *seeds, const BoardMasks *m)
+{
+    Bitboard reach = *seeds, front = *seeds;
+    for (;;)
+    {
+        Bitboard up = BBShr(&front, MAX_FIELD);
+        Bitboard down = BBShl(&front, MAX_FIELD);
+        Bitboard left = BBShr(&front, 1);
+        Bitboard right = BBShl(&front, 1);
+        uint64_t grown = 0;
+        for (int i = 0; i < CELL_WORDS; i++)
+        {
+            uint64_t n = up.w[i] | down.w[i] |
+                         (left.w[i] & m->not_last_col.w[i]) |
+                         (right.w[i] & m->not_first_col.w[i]);
+            n &= free->w[i] & ~reach.w[i];
+            front.w[i] = n;
+            reach.w[i] |= n;
+            grown |= n;
+        }
+        if (!grown) return reach;
+    }
+}
+
+/* BBFlood — заливка области free, связной с клеткой start. */
+static inline Bitboard BBFlood(const Bitboard *free, int start, const BoardMasks *m)
+{
+    Bitboard seed;
+    BBClear(&seed);
+    BBSet(&seed, start);
+    return BBFloodFrom(free, &seed, m);
+}
+
+#endif
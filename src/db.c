@@ -1,12 +1,13 @@
 #include "db.h"
 #include "sqlite3.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 static sqlite3 *db = NULL;
 
-bool open(const char *path)
+bool db_open(const char *path)
 {
     if (sqlite3_open(path, &db) != SQLITE_OK)
     {
@@ -28,6 +29,14 @@ bool open(const char *path)
         "  completed    INTEGER NOT NULL,"
         "  played_at    TEXT NOT NULL,"
         "  FOREIGN KEY(user_id) REFERENCES users(id)"
+        ");"
+        "CREATE TABLE IF NOT EXISTS solutions ("
+        "  hash         INTEGER PRIMARY KEY,"
+        "  moves        BLOB NOT NULL,"
+        "  num_moves    INTEGER NOT NULL,"
+        "  solve_ms     REAL NOT NULL,"
+        "  nodes        INTEGER NOT NULL,"
+        "  solved_at    TEXT NOT NULL"
         ");";
 
     char *err = NULL;
@@ -40,7 +49,7 @@ bool open(const char *path)
     return 1;
 }
 
-void close(void)
+void db_close(void)
 {
     if (db)
     {
@@ -139,3 +148,105 @@ int get_sessions(int user_id, Session *out, int max_count)
     sqlite3_finalize(stmt);
     return count;
 }
+
+/*
+ * Отпечаток уровня: FNV-1a по клеткам поля (стена, цель, ящик, игрок),
+ * а не по массивам goals/boxes — порядок ящиков и целей на него не
+ * влияет. Одинаковая позиция даёт одинаковый ключ в таблице solutions.
+ */
+uint64_t level_fingerprint(const Level *level)
+{
+    unsigned char marks[MAX_FIELD][MAX_FIELD] = {{0}};
+    for (int i = 0; i < level->num_boxes; i++)
+    {
+        marks[level->goals[i].y][level->goals[i].x] |= 2;
+        marks[level->boxes[i].y][level->boxes[i].x] |= 4;
+    }
+    marks[level->player.y][level->player.x] |= 8;
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = (hash ^ (uint64_t)level->width) * 0x100000001b3ULL;
+    hash = (hash ^ (uint64_t)level->height) * 0x100000001b3ULL;
+    for (int y = 0; y < level->height; y++)
+        for (int x = 0; x < level->width; x++)
+        {
+            unsigned char cell = marks[y][x] | (level->cells[y][x] == CELL_WALL);
+            hash = (hash ^ cell) * 0x100000001b3ULL;
+        }
+    return hash;
+}
+
+// ходы упаковываются по 2 бита (направления 0-3), 4 хода в байте
+bool load_solution(uint64_t hash, Solver *out, double *solve_ms, long long *nodes)
+{
+    if (!db) return 0;
+
+    sqlite3_stmt *stmt;
+    sqlite3_prepare_v2(db, "SELECT moves, num_moves, solve_ms, nodes FROM solutions WHERE hash=?;",
+                       -1, &stmt, NULL);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)hash);
+
+    bool found = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const unsigned char *packed = (const unsigned char *)sqlite3_column_blob(stmt, 0);
+        int size = sqlite3_column_bytes(stmt, 0);
+        int num_moves = sqlite3_column_int(stmt, 1);
+        int *moves = (int *)malloc(sizeof(int) * (num_moves > 0 ? num_moves : 1));
+        if (moves && size >= (num_moves + 3) / 4)
+        {
+            for (int i = 0; i < num_moves; i++)
+                moves[i] = (packed[i / 4] >> (2 * (i % 4))) & 3;
+            out->moves = moves;
+            out->num_moves = num_moves;
+            out->current_move = 0;
+            out->timer = 0;
+            out->active = 1;
+            if (solve_ms) *solve_ms = sqlite3_column_double(stmt, 2);
+            if (nodes) *nodes = sqlite3_column_int64(stmt, 3);
+            found = 1;
+        }
+        else
+            free(moves);
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// более длинное решение не заменяет уже сохранённое
+void save_solution(uint64_t hash, const Solver *solver, double solve_ms, long long nodes)
+{
+    if (!db) return;
+
+    int size = (solver->num_moves + 3) / 4;
+    unsigned char *packed = (unsigned char *)calloc(size > 0 ? size : 1, 1);
+    if (!packed) return;
+    for (int i = 0; i < solver->num_moves; i++)
+        packed[i / 4] |= (unsigned char)((solver->moves[i] & 3) << (2 * (i % 4)));
+
+    time_t now = time(NULL);
+    struct tm *t = localtime(&now);
+    char date_str[32];
+    strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M", t);
+
+    sqlite3_stmt *stmt;
+    sqlite3_prepare_v2(db,
+                       "INSERT INTO solutions(hash, moves, num_moves, solve_ms, nodes, solved_at)"
+                       " VALUES(?,?,?,?,?,?)"
+                       " ON CONFLICT(hash) DO UPDATE SET moves=excluded.moves,"
+                       " num_moves=excluded.num_moves, solve_ms=excluded.solve_ms,"
+                       " nodes=excluded.nodes, solved_at=excluded.solved_at"
+                       " WHERE excluded.num_moves < solutions.num_moves;",
+                       -1, &stmt, NULL);
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)hash);
+    sqlite3_bind_blob(stmt, 2, packed, size, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, solver->num_moves);
+    sqlite3_bind_double(stmt, 4, solve_ms);
+    sqlite3_bind_int64(stmt, 5, nodes);
+    sqlite3_bind_text(stmt, 6, date_str, -1, SQLITE_STATIC);
+
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    free(packed);
+}
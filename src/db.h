@@ -22,8 +22,8 @@ typedef struct
     char played_at[32];
 } Session;
 
-bool open(const char *path);
-void close(void);
+bool db_open(const char *path);
+void db_close(void);
 
 int create_user(const char *name);
 int get_all_users(User *out, int max_count);
@@ -32,4 +32,8 @@ int find_user(const char* name);
 void save_session(int user_id, Difficulty diff, int steps, float elapsed, bool completed);
 int get_sessions(int user_id, Session *out, int max_count);
 
+uint64_t level_fingerprint(const Level *level);
+bool load_solution(uint64_t hash, Solver *out, double *solve_ms, long long *nodes);
+void save_solution(uint64_t hash, const Solver *solver, double solve_ms, long long nodes);
+
 #endif
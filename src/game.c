@@ -175,4 +175,21 @@ void ApplyMove(Level *level, int dir)
     level->player.x = nx;
     level->player.y = ny;
     level->step_count++;
-}
\ No newline at end of file
+}
+int CheckSolution(const Level *level, const int *moves, int num_moves)
+{
+    Level copy = *level;
+    copy.undo_head = NULL;
+    copy.undo_count = 0;
+
+    int ok = 1;
+    for (int i = 0; i < num_moves && ok; i++)
+    {
+        int steps = copy.step_count;
+        ApplyMove(&copy, moves[i] & 3);
+        if (copy.step_count == steps) ok = 0; // ход упёрся в стену или ящик
+    }
+    ok = ok && CheckWin(&copy);
+    FreeUndoStack(&copy);
+    return ok;
+}
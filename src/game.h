@@ -6,6 +6,7 @@
 void HandleInput(Level *level);
 void ApplyMove(Level *level, int dir);
 int CheckWin(const Level *level);
+int CheckSolution(const Level *level, const int *moves, int num_moves);
 void PushUndoMove(Level *level);
 void PushUndoPush(Level *level, int box_index);
 void PopUndo(Level *level);
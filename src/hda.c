@@ -0,0 +1,547 @@
+/*
+ * hda.c — многопоточный решатель: HDA* (hash-distributed A*) по
+ * пространству толчков.
+ *
+ * Каждое состояние принадлежит одному потоку — владельцу, выбранному по
+ * старшим битам ключа Zobrist. У каждого потока свои NodePool,
+ * BucketQueue и HashSet (nodes.c), поэтому сами хранилища не
+ * разделяются и не блокируются. Поток раскрывает узлы из своего open
+ * list, а порождённые состояния отправляет владельцам: чужие копит в
+ * пачках по HDA_BATCH и кладёт во входящую очередь владельца (очередь
+ * MPSC без блокировок, HdaQueue), свои обрабатывает сразу. Владелец
+ * проверяет повтор по своему closed list, считает h и ставит узел в
+ * свой open list.
+ *
+ * Ссылка на родителя в узле — пара (поток, индекс в его пуле), поэтому
+ * путь восстанавливается по пулам всех потоков после их остановки.
+ *
+ * Оптимальность. Найденная цель не останавливает поиск, а становится
+ * текущим лучшим решением (best, атомарно). Узлы с f не меньше его g
+ * больше не раскрываются и не добавляются. Поиск закончен, когда все
+ * потоки простаивают и ни одна пачка не в пути: тогда ни одного узла с
+ * f < best не осталось, и best оптимально по числу толчков.
+ *
+ * Завершение определяется одним атомарным счётчиком work = число
+ * активных потоков + число отправленных, но не обработанных пачек.
+ * Отправитель увеличивает его до того, как сам уйдёт в простой, а
+ * получатель становится активным до того, как уменьшит его за
+ * обработанную пачку, поэтому work = 0 только в момент, когда работы
+ * действительно не осталось, и после этого уже не растёт.
+ */
+
+#include "solver.h"
+#include "search.h"
+#include "nodes.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Наибольшее число потоков (номер потока хранится в 8 битах best). */
+#define HDA_MAX_THREADS  64
+/* Раскрытий подряд между проверками входящей очереди. */
+#define HDA_EXPAND_STEP  64
+/* Попыток sched_yield в простое, после которых поток засыпает. */
+#define HDA_IDLE_SPINS   64
+/* best, пока ни одна цель не найдена. */
+#define HDA_NO_GOAL      UINT64_MAX
+
+/* ---------- HdaQueue — очередь пачек без блокировок ---------- */
+
+/*
+ * Интрузивная очередь Вьюкова: писатели добавляют пачку одним атомарным
+ * обменом head, единственный читатель (владелец очереди) снимает пачки с
+ * tail. Заглушка stub позволяет никогда не оставлять очередь пустой.
+ */
+
+static void QueueInit(HdaQueue *q)
+{
+    atomic_init(&q->stub.next, NULL);
+    atomic_init(&q->head, &q->stub);
+    q->tail = &q->stub;
+}
+
+/* QueuePush — добавляет пачку; может вызываться из любого потока. */
+static void QueuePush(HdaQueue *q, HdaBatch *b)
+{
+    atomic_store_explicit(&b->next, NULL, memory_order_relaxed);
+    HdaBatch *prev = atomic_exchange_explicit(&q->head, b, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, b, memory_order_release);
+}
+
+/*
+ * QueuePop — снимает самую старую пачку; вызывается только владельцем.
+ * Возвращает NULL, если очередь пуста или отправитель ещё не дописал
+ * ссылку на свою пачку (она будет получена при следующем вызове).
+ */
+static HdaBatch *QueuePop(HdaQueue *q)
+{
+    HdaBatch *tail = q->tail;
+    HdaBatch *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (tail == &q->stub)
+    {
+        if (!next) return NULL;
+        q->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+    if (next)
+    {
+        q->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&q->head, memory_order_acquire))
+        return NULL;
+    // tail — последняя пачка: ставим за ней заглушку, чтобы её отдать
+    QueuePush(q, &q->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next)
+    {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+/* ---------- Обмен состояниями между потоками ---------- */
+
+/* Owner — поток-владелец состояния (младшие биты хеша занимает HashSet). */
+static int Owner(uint64_t key, int num_threads)
+{
+    return (int)((MixKey(key) >> 40) % (uint64_t)num_threads);
+}
+
+/* BestG — число толчков лучшего найденного решения (H_INF — пока нет). */
+static int BestG(HdaShared *sh)
+{
+    uint64_t best = atomic_load_explicit(&sh->best, memory_order_relaxed);
+    return best == HDA_NO_GOAL ? H_INF : (int)(best >> 40);
+}
+
+/* Abort — останавливает все потоки; запоминается первая причина. */
+static void Abort(HdaShared *sh, SolveResult why)
+{
+    int running = -1;
+    atomic_compare_exchange_strong(&sh->abort, &running, (int)why);
+}
+
+/* Aborted — поиск остановлен досрочно (память, лимиты, отмена). */
+static bool Aborted(HdaShared *sh)
+{
+    return atomic_load(&sh->abort) >= 0;
+}
+
+/* RecordGoal — записывает цель (узел idx пула потока w), если она лучше best. */
+static void RecordGoal(HdaWorker *w, int g, int idx)
+{
+    HdaShared *sh = w->shared;
+    uint64_t mine = (uint64_t)g << 40 | (uint64_t)w->id << 32 | (uint32_t)idx;
+    uint64_t best = atomic_load(&sh->best);
+    while (mine < best && !atomic_compare_exchange_weak(&sh->best, &best, mine))
+        ;
+}
+
+/*
+ * Receive — владелец принимает состояние: если оно новое или найдено с
+ * меньшим g и может улучшить лучшее решение, создаёт узел и ставит его в
+ * свой open list. Возвращает 0, если закончилась память (или доля
+ * потока в лимите памяти).
+ */
+static int Receive(HdaWorker *w, const HdaMsg *m)
+{
+    const SearchContext *ctx = w->shared->ctx;
+    int nb = ctx->num_boxes;
+
+    uint32_t slot;
+    int seen = HashSetFind(w->closed, w->pool, m->key, &m->state, nb, &slot);
+    if (seen >= 0 && PoolNode(w->pool, seen)->g <= m->g)
+    {
+        w->st.duplicates++;
+        return 1;
+    }
+
+    int h = StateHeuristic(ctx, &m->state);
+    if (h == H_INF) { w->st.pruned_h++; return 1; } // нерешаемо
+    if (m->g + h >= BestG(w->shared))
+        return 1; // не лучше уже найденного решения
+
+    // База образцов общая: каждый поток несёт свою долю её памяти
+    if (OverMemory(&w->shared->budget, w->pool->bytes + w->open->bytes + w->closed->bytes +
+                                       ctx->pdb.bytes / w->shared->num_threads +
+                                       PoolGrowthBytes(w->pool) + HashSetGrowthBytes(w->closed)))
+        return 0;
+
+    AStarNode node;
+    node.key = m->key;
+    node.parent_owner = m->parent_owner;
+    node.parent = m->parent;
+    node.direction = m->direction;
+    node.g = m->g;
+    node.f = m->g + h;
+
+    int idx = PoolAdd(w->pool, &node, &m->state);
+    if (idx < 0) return 0;
+
+    if (seen < 0 && w->closed->count * 2 >= w->closed->capacity) // load factor > 0.5
+    {
+        if (!HashSetGrow(w->closed)) return 0;
+        HashSetFind(w->closed, w->pool, m->key, &m->state, nb, &slot);
+    }
+    HashSetPut(w->closed, slot, m->key, idx);
+
+    // Цель (h = 0 — каждый ящик на своей цели) сразу становится кандидатом
+    // в лучшее решение: раскрывать её незачем, а отсечение по best
+    // начинает работать на шаг раньше
+    if (h == 0)
+    {
+        RecordGoal(w, node.g, idx);
+        return 1;
+    }
+    return BucketPush(w->open, node.f, node.g, idx);
+}
+
+/* Flush — отправляет накопленную пачку для потока t. */
+static void Flush(HdaWorker *w, int t)
+{
+    HdaBatch *b = w->outbox[t];
+    if (!b) return;
+    w->outbox[t] = NULL;
+    atomic_fetch_add(&w->shared->work, 1); // до отправки: пачка уже «в пути»
+    QueuePush(&w->shared->workers[t].inbox, b);
+}
+
+/*
+ * Send — передаёт состояние владельцу: своё обрабатывается сразу, чужое
+ * дописывается в пачку, полная пачка отправляется. Возвращает 0, если
+ * закончилась память.
+ */
+static int Send(HdaWorker *w, const HdaMsg *m)
+{
+    int t = Owner(m->key, w->shared->num_threads);
+    if (t == w->id) return Receive(w, m);
+
+    HdaBatch *b = w->outbox[t];
+    if (!b)
+    {
+        b = (HdaBatch *)malloc(sizeof(HdaBatch));
+        if (!b) return 0;
+        b->count = 0;
+        w->outbox[t] = b;
+    }
+    b->msgs[b->count++] = *m;
+    if (b->count == HDA_BATCH) Flush(w, t);
+    return 1;
+}
+
+/* ProcessBatch — принимает все состояния пачки и освобождает её. */
+static int ProcessBatch(HdaWorker *w, HdaBatch *b)
+{
+    int ok = 1;
+    for (int i = 0; i < b->count && ok; i++)
+        ok = Receive(w, &b->msgs[i]);
+    free(b);
+    atomic_fetch_sub(&w->shared->work, 1);
+    return ok;
+}
+
+/* ---------- Поток-исполнитель ---------- */
+
+/*
+ * ExpandNode — раскрывает узел cur_idx своего пула: пропускает устаревшие
+ * копии и узлы, которые не улучшат лучшее решение, потомков рассылает
+ * владельцам (цели в open list не попадают — их записывает Receive).
+ * Возвращает 0 при нехватке памяти.
+ */
+static int ExpandNode(HdaWorker *w, int cur_idx)
+{
+    HdaShared *sh = w->shared;
+    const SearchContext *ctx = sh->ctx;
+
+    const AStarNode *cur = PoolNode(w->pool, cur_idx); // узлы пула не переезжают
+    uint64_t cur_key = cur->key;
+    int cur_g = cur->g;
+    int cur_f = cur->f;
+
+    PackedState cur_state;
+    NodeState(ctx, w->pool, cur_idx, &cur_state);
+    uint32_t slot;
+    if (HashSetFind(w->closed, w->pool, cur_key, &cur_state, ctx->num_boxes, &slot) != cur_idx)
+        return 1; // состояние позже найдено с меньшим g
+    if (cur_f >= BestG(sh))
+        return 1;
+
+    w->iterations++;
+    if (w->open->size >= w->st.open_peak) w->st.open_peak = w->open->size + 1;
+    if (w->iterations % PROGRESS_STEP == 0)
+    {
+        // Прогресс публикуется суммарный; фронт оценивается по своему open list
+        SolveResult why;
+        long long total = atomic_fetch_add(&sh->expanded, PROGRESS_STEP) + PROGRESS_STEP;
+        if (PollBudget(&sh->budget, total, w->open->size * sh->num_threads, cur_f, &why))
+            Abort(sh, why);
+    }
+
+    SearchChild children[MAX_CHILDREN];
+    int num_children = ExpandState(ctx, &cur_state, cur_key, children, &w->st.prune);
+    w->st.generated += num_children;
+    for (int c = 0; c < num_children; c++)
+    {
+        HdaMsg m;
+        m.key = children[c].key;
+        m.state = children[c].state;
+        m.parent_owner = (unsigned short)w->id;
+        m.parent = cur_idx;
+        m.direction = children[c].direction;
+        m.g = cur_g + 1;
+        if (!Send(w, &m)) return 0;
+    }
+    return 1;
+}
+
+/*
+ * WorkerMain — цикл потока: принять входящие пачки, раскрыть до
+ * HDA_EXPAND_STEP узлов, разослать накопленные пачки. Когда open list
+ * пуст, поток уходит в простой и ждёт пачку либо конца поиска (work = 0).
+ */
+static void *WorkerMain(void *arg)
+{
+    HdaWorker *w = (HdaWorker *)arg;
+    HdaShared *sh = w->shared;
+    long long max_iterations = sh->budget.max_nodes;
+    const struct timespec idle_pause = {0, 50000}; // 50 мкс
+
+    while (!Aborted(sh))
+    {
+        HdaBatch *b;
+        while ((b = QueuePop(&w->inbox)))
+            if (!ProcessBatch(w, b)) Abort(sh, SOLVE_OUT_OF_MEMORY);
+
+        int popped = 0;
+        while (popped < HDA_EXPAND_STEP)
+        {
+            int idx = BucketPop(w->open);
+            if (idx < 0) break;
+            popped++;
+            if (!ExpandNode(w, idx)) Abort(sh, SOLVE_OUT_OF_MEMORY);
+        }
+        for (int t = 0; t < sh->num_threads; t++)
+            Flush(w, t);
+
+        if (w->iterations >= max_iterations) Abort(sh, SOLVE_BUDGET);
+        if (popped > 0) continue;
+
+        // Простой: своя работа кончилась, ждём пачку или конца поиска
+        atomic_fetch_sub(&sh->work, 1);
+        for (int spins = 0;; spins++)
+        {
+            if (atomic_load(&sh->work) == 0 || Aborted(sh))
+                return NULL;
+            b = QueuePop(&w->inbox);
+            if (b)
+            {
+                atomic_fetch_add(&sh->work, 1); // снова активен, пока пачка на счету
+                if (!ProcessBatch(w, b)) Abort(sh, SOLVE_OUT_OF_MEMORY);
+                break;
+            }
+            if (spins < HDA_IDLE_SPINS)
+                sched_yield();
+            else
+                nanosleep(&idle_pause, NULL); // долгий простой — не жжём ядро
+        }
+    }
+    return NULL;
+}
+
+/* ---------- Главная функция: HDA* поиск решения ---------- */
+
+/* FreeWorker — освобождает хранилища потока и оставшиеся пачки. */
+static void FreeWorker(HdaWorker *w, int num_threads)
+{
+    FreeNodePool(w->pool);
+    FreeBucketQueue(w->open);
+    FreeHashSet(w->closed);
+    if (w->outbox)
+        for (int t = 0; t < num_threads; t++)
+            free(w->outbox[t]);
+    free(w->outbox);
+    HdaBatch *b;
+    while ((b = QueuePop(&w->inbox)))
+        free(b);
+}
+
+/*
+ * RunHDA — HDA* поиск в opt->threads потоках (<= 0 — по числу ядер);
+ * режим SOLVER_HDA у SolveLevelEx. Найденное решение оптимально по
+ * числу толчков.
+ *
+ * Лимиты раскрытий и памяти делятся между потоками поровну: каждый
+ * поток раскрывает не больше max_nodes / threads узлов и держит не
+ * больше max_bytes / threads байт в своих хранилищах вместе с долей
+ * общей базы образцов. Первый поток,
+ * упёршийся в лимит, останавливает всех (Abort), и его причина
+ * становится результатом.
+ */
+SolveResult RunHDA(const Level *level, Solver *solver, const SolverOptions *opt, SolverStats *stats)
+{
+    int threads = opt->threads;
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > HDA_MAX_THREADS) threads = HDA_MAX_THREADS;
+
+    SolveResult result = SOLVE_OUT_OF_MEMORY;
+    SolverStats st = {0};
+    double t_start = NowMs(), t_init = t_start, t_search = t_start;
+    int started = 0;
+    HdaShared sh;
+    pthread_t tids[HDA_MAX_THREADS];
+
+    InitBudget(&sh.budget, opt, MAX_ITERATIONS);
+    long long pdb_bytes = PatternBudget(&sh.budget); // база общая — от всего лимита
+    sh.budget.max_nodes /= threads;
+    sh.budget.max_bytes /= threads;
+
+    SearchContext *ctx = (SearchContext *)calloc(1, sizeof(SearchContext)); // до InitSearch базы нет
+    sh.workers = (HdaWorker *)calloc(threads, sizeof(HdaWorker));
+    if (!ctx || !sh.workers)
+        goto cleanup;
+
+    InitSearch(level, ctx, opt->memo, pdb_bytes);
+    sh.ctx = ctx;
+    sh.num_threads = threads;
+    atomic_init(&sh.work, threads);
+    atomic_init(&sh.abort, -1);
+    atomic_init(&sh.best, HDA_NO_GOAL);
+    atomic_init(&sh.expanded, 0);
+
+    // Хеш-таблицы делят начальный объём A* между потоками
+    int hash_cap = InitialHashCap(opt->max_bytes, threads);
+
+    for (int t = 0; t < threads; t++)
+    {
+        HdaWorker *w = &sh.workers[t];
+        w->id = t;
+        w->shared = &sh;
+        QueueInit(&w->inbox);
+        w->pool = CreateNodePool(NODES_MAX_CAP / threads, !ctx->ranks.exact);
+        w->open = CreateBucketQueue();
+        w->closed = CreateHashSet(hash_cap);
+        w->outbox = (HdaBatch **)calloc(threads, sizeof(HdaBatch *));
+        if (!w->pool || !w->open || !w->closed || !w->outbox)
+            goto cleanup;
+    }
+    t_init = t_search = NowMs();
+
+    // Корень сразу принимает его владелец, до запуска потоков
+    {
+        HdaMsg root;
+        root.key = ctx->root_key;
+        root.state = ctx->root;
+        root.parent_owner = 0;
+        root.parent = -1;
+        root.direction = -1;
+        root.g = 0;
+        if (!Receive(&sh.workers[Owner(root.key, threads)], &root))
+            goto cleanup;
+    }
+
+    for (; started < threads; started++)
+        if (pthread_create(&tids[started], NULL, WorkerMain, &sh.workers[started]) != 0)
+        {
+            Abort(&sh, SOLVE_OUT_OF_MEMORY);
+            break;
+        }
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+    t_search = NowMs();
+
+    long long nodes = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        const HdaWorker *w = &sh.workers[t];
+        st.expanded += w->iterations;
+        st.generated += w->st.generated;
+        st.duplicates += w->st.duplicates;
+        st.prune.freeze += w->st.prune.freeze;
+        st.prune.corral += w->st.prune.corral;
+        st.pruned_h += w->st.pruned_h;
+        st.open_peak += w->st.open_peak; // сумма пиков потоков — оценка сверху
+        st.reallocs += w->pool->num_chunks + w->open->reallocs;
+        st.rehashes += w->closed->rehashes;
+        st.bytes += w->pool->bytes + w->open->bytes + w->closed->bytes;
+        nodes += w->pool->count;
+    }
+    st.pool_peak = nodes;
+
+    uint64_t best = atomic_load(&sh.best);
+    int stop = atomic_load(&sh.abort);
+    bool found = best != HDA_NO_GOAL && stop < 0;
+    result = stop >= 0 ? (SolveResult)stop : SOLVE_UNSOLVABLE;
+
+    if (found)
+    {
+        // Цепочка родителей проходит по пулам разных потоков
+        int num_pushes = (int)(best >> 40);
+        int owner = (int)((best >> 32) & 0xff);
+        int idx = (int)(uint32_t)best;
+        PackedState *path = (PackedState *)malloc(sizeof(PackedState) * (num_pushes + 1));
+        int *dirs = (int *)malloc(sizeof(int) * (num_pushes + 1));
+        result = SOLVE_OUT_OF_MEMORY;
+        if (path && dirs)
+        {
+            for (int k = num_pushes; k >= 0; k--)
+            {
+                const AStarNode *node = PoolNode(sh.workers[owner].pool, idx);
+                NodeState(ctx, sh.workers[owner].pool, idx, &path[k]);
+                dirs[k] = node->direction;
+                owner = node->parent_owner;
+                idx = node->parent;
+            }
+            if (BuildMoves(ctx, path, dirs, num_pushes, solver))
+            {
+                result = SOLVE_FOUND;
+                st.solutions = 1;
+                st.pushes = st.lower_bound = num_pushes;
+            }
+        }
+        free(path);
+        free(dirs);
+    }
+
+    printf("[solver] hda threads=%d  iterations=%lld  pool=%lld  freeze=%lld  corral=%lld  found=%s\n",
+           threads, st.expanded, nodes, st.prune.freeze, st.prune.corral, found ? "YES" : "NO");
+
+cleanup:
+    if (stats)
+    {
+        double t_end = NowMs();
+        st.init_ms = t_init - t_start;
+        st.search_ms = t_search - t_init;
+        st.path_ms = t_end - t_search;
+        if (ctx)
+        {
+            st.pdb_ms = ctx->pdb.build_ms;
+            st.pdb_bytes = ctx->pdb.bytes;
+        }
+        *stats = st;
+    }
+    if (sh.workers)
+        for (int t = 0; t < threads; t++)
+            if (sh.workers[t].shared) // поток успели подготовить
+                FreeWorker(&sh.workers[t], threads);
+    free(sh.workers);
+    if (ctx) FreeSearch(ctx);
+    free(ctx);
+    return result;
+}
+
+/*
+ * SolveLevelParallel — HDA* в threads потоках без дополнительных
+ * лимитов; true, если решение найдено.
+ */
+bool SolveLevelParallel(const Level *level, Solver *solver, int threads)
+{
+    SolverOptions opt = {.algorithm = SOLVER_HDA, .threads = threads};
+    return SolveLevelEx(level, solver, &opt, NULL) == SOLVE_FOUND;
+}
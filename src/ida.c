@@ -0,0 +1,279 @@
+/*
+ * ida.c — режим решателя с ограниченной памятью: IDA* (iterative
+ * deepening A*) по пространству толчков.
+ *
+ * A* (solver.c) хранит каждое порождённое состояние, и на трудных
+ * уровнях его память растёт до гигабайт. IDA* вместо этого повторяет
+ * обход в глубину с порогом f = g + h: ветки с f больше порога
+ * отсекаются, а наименьшее из отсечённых f становится порогом следующей
+ * итерации. Первое найденное решение оптимально по числу толчков — та же
+ * допустимая эвристика, что и у A*.
+ *
+ * Память постоянна и выделяется один раз:
+ *   IdaFrame[IDA_MAX_DEPTH + 1] — явный стек обхода; каждый кадр хранит
+ *       потомков состояния, отсортированных по h (сначала перспективные).
+ *   IdaEntry[IDA_TT_SIZE] — таблица транспозиций с прямой адресацией по
+ *       ключу Zobrist. Запись помнит наименьшее g, с которым состояние
+ *       встречено на текущей итерации; повторный заход с g не меньше
+ *       отсекается — его поддерево уже обойдено с большим запасом. При
+ *       коллизии запись просто затирается: таблица только ускоряет
+ *       поиск и не влияет на его корректность.
+ *
+ * Представление состояния, генерация толчков, эвристика и восстановление
+ * шагов игрока — общие с A* (search.c).
+ */
+
+#include "solver.h"
+#include "search.h"
+#include "nodes.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Таблица транспозиций: 2^20 записей по 16 байт = 16 МБ. */
+#define IDA_TT_SIZE     1048576
+/* Наибольшая длина решения в толчках (стек — около 2 МБ). */
+#define IDA_MAX_DEPTH   1000
+/* Лимит раскрытых состояний за весь поиск — защита от зависания. */
+#define IDA_MAX_NODES   200000000LL
+
+/*
+ * TTSeen — проверяет состояние по таблице транспозиций и обновляет её.
+ * Возвращает 1, если на этой итерации состояние уже встречалось с g не
+ * больше текущего (ветку можно отсечь).
+ */
+static int TTSeen(IdaEntry *tt, uint64_t key, int g, int iteration)
+{
+    IdaEntry *e = &tt[MixKey(key) & (IDA_TT_SIZE - 1)];
+    if (e->key == key && e->iteration == iteration && e->g <= g)
+        return 1;
+    e->key = key;
+    e->g = g;
+    e->iteration = iteration;
+    return 0;
+}
+
+/*
+ * ExpandFrame — заполняет кадр потомками его состояния: толчки без
+ * дедлоков и с достижимыми целями, отсортированные по h вставками.
+ */
+static void ExpandFrame(const SearchContext *ctx, IdaFrame *f, SolverStats *st)
+{
+    SearchChild children[MAX_CHILDREN];
+    int n = ExpandState(ctx, &f->state, f->key, children, &st->prune);
+    st->generated += n;
+
+    f->num_children = 0;
+    f->next = 0;
+    for (int c = 0; c < n; c++)
+    {
+        int h = StateHeuristic(ctx, &children[c].state);
+        if (h == H_INF) { st->pruned_h++; continue; } // ящики нельзя развести по целям
+
+        int j = f->num_children++;
+        while (j > 0 && f->h[j - 1] > h)
+        {
+            f->children[j] = f->children[j - 1];
+            f->h[j] = f->h[j - 1];
+            j--;
+        }
+        f->children[j] = children[c];
+        f->h[j] = h;
+    }
+}
+
+/*
+ * RunIDA — ищет решение с минимальным числом толчков в ограниченной
+ * памяти (около 18 МБ независимо от уровня); режим SOLVER_IDA у
+ * SolveLevelEx. Медленнее A* из-за повторных обходов на каждой итерации,
+ * зато не упирается в память. Если лимит памяти в opt меньше
+ * фиксированного объёма, поиск сразу возвращает SOLVE_OUT_OF_MEMORY.
+ *
+ * В stats open_peak — наибольшая глубина стека, duplicates — отсечения
+ * таблицей транспозиций; пула нет.
+ *
+ * Обход в глубину идёт по явному стеку:
+ *   1. Взять верхний кадр и его следующего потомка.
+ *   2. Если f потомка больше порога — запомнить f как кандидата на
+ *      следующий порог; остальные потомки (они отсортированы по h)
+ *      тоже за порогом, кадр снимается.
+ *   3. Если потомок — цель (h = 0, каждый ящик на своей цели), путь
+ *      лежит в стеке.
+ *   4. Иначе, если таблица транспозиций не отсекла потомка, положить его
+ *      кадр на стек и раскрыть.
+ */
+SolveResult RunIDA(const Level *level, Solver *solver, const SolverOptions *opt, SolverStats *stats)
+{
+    SolveResult result = SOLVE_OUT_OF_MEMORY;
+    SolverStats st = {0};
+    double t_start = NowMs(), t_init = t_start, t_search = t_start;
+    IdaEntry *tt = NULL;
+    IdaFrame *stack = NULL;
+    SearchContext *ctx = NULL;
+
+    SearchBudget budget;
+    InitBudget(&budget, opt, IDA_MAX_NODES);
+    st.bytes = (long long)sizeof(IdaEntry) * IDA_TT_SIZE +
+               (long long)sizeof(IdaFrame) * (IDA_MAX_DEPTH + 1);
+    if (OverMemory(&budget, st.bytes))
+        goto cleanup;
+
+    tt = (IdaEntry *)calloc(IDA_TT_SIZE, sizeof(IdaEntry));
+    stack = (IdaFrame *)malloc(sizeof(IdaFrame) * (IDA_MAX_DEPTH + 1));
+    ctx = (SearchContext *)calloc(1, sizeof(SearchContext)); // до InitSearch базы нет
+    if (!tt || !stack || !ctx)
+        goto cleanup;
+
+    // База образцов берёт свою долю лимита, но не больше, чем осталось
+    // после таблицы и стека
+    long long pdb_bytes = PatternBudget(&budget);
+    if (budget.max_bytes > 0 && pdb_bytes > budget.max_bytes - st.bytes)
+        pdb_bytes = budget.max_bytes - st.bytes;
+    InitSearch(level, ctx, opt->memo, pdb_bytes);
+    t_init = t_search = NowMs();
+
+    int bound = StateHeuristic(ctx, &ctx->root);
+    if (bound == H_INF) // ящики не развести по целям
+    {
+        result = SOLVE_UNSOLVABLE;
+        goto cleanup;
+    }
+
+    long long nodes = 0;
+    int iteration = 0;
+    int found_depth = -1; // глубина кадра с целевым состоянием
+    SearchChild goal = {0};
+
+    if (bound == 0) // уровень уже решён
+    {
+        found_depth = 0;
+        goto done;
+    }
+
+    result = SOLVE_BUDGET; // если порог перерастёт IDA_MAX_DEPTH
+    while (bound <= IDA_MAX_DEPTH)
+    {
+        iteration++;
+        int next_bound = H_INF;
+
+        // Корень итерации
+        IdaFrame *root = &stack[0];
+        root->state = ctx->root;
+        root->key = ctx->root_key;
+        root->direction = -1;
+        root->g = 0;
+        TTSeen(tt, root->key, 0, iteration);
+        ExpandFrame(ctx, root, &st);
+
+        int depth = 0;
+        while (depth >= 0)
+        {
+            IdaFrame *f = &stack[depth];
+            if (f->next >= f->num_children) { depth--; continue; }
+
+            int c = f->next++;
+            int child_g = f->g + 1;
+            int child_f = child_g + f->h[c];
+            if (child_f > bound)
+            {
+                if (child_f < next_bound) next_bound = child_f;
+                f->next = f->num_children;
+                continue;
+            }
+
+            const SearchChild *ch = &f->children[c];
+            if (f->h[c] == 0)
+            {
+                goal = *ch;
+                found_depth = depth + 1;
+                goto done;
+            }
+
+            if (TTSeen(tt, ch->key, child_g, iteration)) { st.duplicates++; continue; }
+
+            if (++nodes >= budget.max_nodes) goto done; // result = SOLVE_BUDGET
+            if (nodes % PROGRESS_STEP == 0 &&
+                PollBudget(&budget, nodes, depth + 1, bound, &result))
+                goto done; // отмена из UI или истёк срок
+
+            IdaFrame *nf = &stack[depth + 1];
+            nf->state = ch->state;
+            nf->key = ch->key;
+            nf->direction = ch->direction;
+            nf->g = child_g;
+            ExpandFrame(ctx, nf, &st);
+            depth++;
+            if (depth >= st.open_peak) st.open_peak = depth + 1;
+        }
+
+        if (next_bound == H_INF) // дерево исчерпано — решения нет
+        {
+            result = SOLVE_UNSOLVABLE;
+            break;
+        }
+        bound = next_bound;
+    }
+
+done:
+    t_search = NowMs();
+    st.expanded = nodes;
+    if (found_depth >= 0)
+    {
+        // Путь — состояния кадров стека от корня плюс найденная цель
+        PackedState *path = (PackedState *)malloc(sizeof(PackedState) * (found_depth + 1));
+        int *dirs = (int *)malloc(sizeof(int) * (found_depth + 1));
+        result = SOLVE_OUT_OF_MEMORY;
+        if (path && dirs)
+        {
+            path[0] = ctx->root;
+            dirs[0] = -1;
+            for (int k = 1; k < found_depth; k++)
+            {
+                path[k] = stack[k].state;
+                dirs[k] = stack[k].direction;
+            }
+            if (found_depth > 0)
+            {
+                path[found_depth] = goal.state;
+                dirs[found_depth] = goal.direction;
+            }
+            if (BuildMoves(ctx, path, dirs, found_depth, solver))
+            {
+                result = SOLVE_FOUND;
+                st.solutions = 1;
+                st.pushes = st.lower_bound = found_depth;
+            }
+        }
+        free(path);
+        free(dirs);
+    }
+
+    printf("[solver] ida iterations=%d  bound=%d  nodes=%lld  freeze=%lld  corral=%lld  found=%s\n",
+           iteration, bound, nodes, st.prune.freeze, st.prune.corral, found_depth >= 0 ? "YES" : "NO");
+
+cleanup:
+    if (stats)
+    {
+        double t_end = NowMs();
+        st.init_ms = t_init - t_start;
+        st.search_ms = t_search - t_init;
+        st.path_ms = t_end - t_search;
+        if (ctx)
+        {
+            st.pdb_ms = ctx->pdb.build_ms;
+            st.pdb_bytes = ctx->pdb.bytes;
+        }
+        *stats = st;
+    }
+    free(tt);
+    free(stack);
+    if (ctx) FreeSearch(ctx);
+    free(ctx);
+    return result;
+}
+
+/* SolveLevelIDA — IDA* без дополнительных лимитов; true, если решение найдено. */
+bool SolveLevelIDA(const Level *level, Solver *solver)
+{
+    SolverOptions opt = {.algorithm = SOLVER_IDA};
+    return SolveLevelEx(level, solver, &opt, NULL) == SOLVE_FOUND;
+}
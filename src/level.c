@@ -1,13 +1,57 @@
 #include "level.h"
 #include "game.h"
+#include "analysis.h"
+#include "solver.h"
+#include "search.h"
+#include "nodes.h"
+#include "bitboard.h"
 #include "types.h"
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <unistd.h>
 
 static const int DX[4] = {0, 0, -1, 1};
 static const int DY[4] = {-1, 1, 0, 0};
 
+static uint64_t SplitMix64(uint64_t *x)
+{ // splitmix64: разворачивает одно 64-битное зерно в состояние xoshiro
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void RngSeed(LevelRng *rng, uint64_t seed)
+{ // seeds xoshiro256** state
+    for (int i = 0; i < 4; i++)
+        rng->s[i] = SplitMix64(&seed);
+}
+
+static uint64_t Rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t RngNext(LevelRng *rng)
+{ // xoshiro256**
+    uint64_t *s = rng->s;
+    uint64_t result = Rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = Rotl(s[3], 45);
+    return result;
+}
+
+static int RngInt(LevelRng *rng, int n)
+{ // random number in [0, n): старшие 32 бита, умноженные на n
+    return (int)(((RngNext(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
 static int HasBox(Level *level, int x, int y)
 { // check is box
     for (int i = 0; i < level->num_boxes; i++)
@@ -15,23 +59,23 @@ static int HasBox(Level *level, int x, int y)
     return 0;
 }
 
-static void ShuffleDirs(int *dirs)
+static void ShuffleDirs(int *dirs, LevelRng *rng)
 { // shuffle directions
     for (int i = 0; i < 4; i++)
     {
-        int r = rand() % 4;
+        int r = RngInt(rng, 4);
         int temp = dirs[i];
         dirs[i] = dirs[r];
         dirs[r] = temp;
     }
 }
 
-static void CarveMaze(Level *level, int x, int y)
+static void CarveMaze(Level *level, int x, int y, LevelRng *rng)
 { // recursive Backtracker for corridors 1x1
     level->cells[y][x] = CELL_FLOOR;
 
     int dirs[] = {0, 1, 2, 3};
-    ShuffleDirs(dirs);
+    ShuffleDirs(dirs, rng);
 
     for (int i = 0; i < 4; i++)
     {
@@ -50,20 +94,20 @@ static void CarveMaze(Level *level, int x, int y)
                 // ломаем стену между нами и целью
                 level->cells[y + dy][x + dx] = CELL_FLOOR;
                 // рекурсивно идем дальше
-                CarveMaze(level, nx, ny);
+                CarveMaze(level, nx, ny, rng);
             }
         }
     }
 }
 
-static void GenerateMaze(Level *const level)
+static void GenerateMaze(Level *const level, LevelRng *rng)
 { // generating map
 
     // вырезаем лабиринт. обязательно начинаем с нечетных координат
     // иначе коридоры могут "прилипнуть" к краю карты
-    int startX = 1 + (rand() % ((level->width - 2) / 2)) * 2;
-    int startY = 1 + (rand() % ((level->height - 2) / 2)) * 2;
-    CarveMaze(level, startX, startY);
+    int startX = 1 + RngInt(rng, (level->width - 2) / 2) * 2;
+    int startY = 1 + RngInt(rng, (level->height - 2) / 2) * 2;
+    CarveMaze(level, startX, startY, rng);
 
     // создаем "комнаты" и циклы
     // ломаем немного случайных стен, чтобы появились открытые пространства и обходные пути
@@ -72,8 +116,8 @@ static void GenerateMaze(Level *const level)
 
     for (int i = 0; i < extra_spaces; i++)
     {
-        int rx = 1 + rand() % (level->width - 2);
-        int ry = 1 + rand() % (level->height - 2);
+        int rx = 1 + RngInt(rng, level->width - 2);
+        int ry = 1 + RngInt(rng, level->height - 2);
 
         if (level->cells[ry][rx] == CELL_WALL)
         {
@@ -118,9 +162,10 @@ static int IsCornerDeadlock(Level *const level, int x, int y)
            (wall_down && wall_left)|| (wall_down && wall_right);
 }
 
-static int IsDeadlock(Level *const level, Position box)
+static int IsDeadlock(Level *const level, const PushTable *pt, Position box)
 { // is deadlock
-    if (IsCornerDeadlock(level, box.x, box.y)) return 1;
+    // мёртвая клетка (угол, участок вдоль стены без целей) — та же таблица, что у решателя
+    if (IsDeadSquare(pt, box.y * MAX_FIELD + box.x)) return 1;
 
     // Проверка 2x2 блоков (стены + ящики), которые невозможно сдвинуть
     int x = box.x, y = box.y;
@@ -142,15 +187,15 @@ static int IsDeadlock(Level *const level, Position box)
     return 0;
 }
 
-static int PlaceGoalsAndBoxes(Level *const level)
+static int PlaceGoalsAndBoxes(Level *const level, LevelRng *rng)
 { // places goals and boxes
     int placed = 0;
     int attempts = 0;
     while (placed < level->num_boxes && attempts < 1000)
     {
         attempts++;
-        int x = 2 + rand() % (level->width - 4);
-        int y = 2 + rand() % (level->height - 4);
+        int x = 2 + RngInt(rng, level->width - 4);
+        int y = 2 + RngInt(rng, level->height - 4);
 
         if (level->cells[y][x] != CELL_FLOOR) continue;
 
@@ -173,7 +218,7 @@ static int PlaceGoalsAndBoxes(Level *const level)
     return placed == level->num_boxes;
 }
 
-static void ReverseSolve(Level *level, int target_moves)
+static void ReverseSolve(Level *level, int target_moves, LevelRng *rng)
 { // algorithm for checking solving
     for (int i = 0; i < target_moves; i++)
     {
@@ -183,8 +228,8 @@ static void ReverseSolve(Level *level, int target_moves)
         int moved = 0;
         for (int attempts = 0; attempts < 100 && !moved; attempts++)
         {
-            int box_idx = rand() % level->num_boxes;
-            int dir = rand() % 4;
+            int box_idx = RngInt(rng, level->num_boxes);
+            int dir = RngInt(rng, 4);
 
             int bx = level->boxes[box_idx].x;
             int by = level->boxes[box_idx].y;
@@ -221,19 +266,158 @@ static int IsOnGoal(Level *level, Position box)
     return 0;
 }
 
-static int HasDeadlock(Level *level)
+static int HasDeadlock(Level *level, const PushTable *pt)
 { // checks for deadlocs (returns 1 if is)
     for (int i = 0; i < level->num_boxes; i++)
     {
         if (IsOnGoal(level, level->boxes[i])) continue;
-        if (IsDeadlock(level, level->boxes[i])) return 1;
+        if (IsDeadlock(level, pt, level->boxes[i])) return 1;
     }
     return 0;
 }
 
-Level GenerateLevel(Difficulty difficulty)
+static double ElapsedMs(const struct timespec *t0)
 {
-    srand(time(NULL));
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1000.0 + (t1.tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+static bool SeenInsert(uint64_t *seen, int mask, uint64_t key)
+{ // открытая адресация по ключам состояний; false — ключ уже был
+    if (key == 0) key = UINT64_MAX; // 0 — пустая ячейка
+    for (uint64_t i = MixKey(key) & (uint64_t)mask;; i = (i + 1) & (uint64_t)mask)
+    {
+        if (seen[i] == key) return false;
+        if (seen[i] == 0)
+        {
+            seen[i] = key;
+            return true;
+        }
+    }
+}
+
+static bool ReverseBfs(Level *level, int max_states, LevelRng *rng)
+{ // pull BFS from the solved state (ящики на целях), не больше max_states состояний;
+  // уровень встаёт в самое далёкое состояние, путь до целей — его решение
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    SearchContext ctx;
+    InitPullSearch(level, &ctx);
+    int nb = level->num_boxes;
+
+    // глубина в обходе в ширину — наименьшее число притягиваний от целей,
+    // т.е. оптимальное число толчков до решения
+    int cap = 1;
+    while (cap < 2 * max_states) cap <<= 1;
+    PackedState *states = (PackedState *)malloc(sizeof(PackedState) * max_states);
+    uint64_t *keys = (uint64_t *)malloc(sizeof(uint64_t) * max_states);
+    int *parent = (int *)malloc(sizeof(int) * max_states);
+    int *depth = (int *)malloc(sizeof(int) * max_states);
+    signed char *dir = (signed char *)malloc((size_t)max_states);
+    uint64_t *seen = (uint64_t *)calloc((size_t)cap, sizeof(uint64_t));
+    PackedState path[MAX_FIELD * MAX_FIELD];
+    int dirs[MAX_FIELD * MAX_FIELD];
+    int *moves = NULL;
+    bool ok = false;
+    if (!states || !keys || !parent || !depth || !dir || !seen) goto done;
+
+    SearchChild kids[MAX_CHILDREN];
+    int count = 0;
+    int n = GoalStates(&ctx, kids, MAX_CHILDREN);
+    for (int i = 0; i < n && count < max_states; i++)
+    {
+        if (!SeenInsert(seen, cap - 1, kids[i].key)) continue;
+        states[count] = kids[i].state;
+        keys[count] = kids[i].key;
+        parent[count] = -1;
+        depth[count] = 0;
+        dir[count] = -1;
+        count++;
+    }
+    for (int head = 0; head < count && count < max_states; head++)
+    {
+        n = ExpandPulls(&ctx, &states[head], keys[head], kids);
+        for (int i = 0; i < n && count < max_states; i++)
+        {
+            if (!SeenInsert(seen, cap - 1, kids[i].key)) continue;
+            states[count] = kids[i].state;
+            keys[count] = kids[i].key;
+            parent[count] = head;
+            depth[count] = depth[head] + 1;
+            dir[count] = (signed char)kids[i].direction;
+            count++;
+        }
+    }
+    if (count == 0 || depth[count - 1] == 0 || depth[count - 1] >= MAX_FIELD * MAX_FIELD) goto done;
+
+    // самые далёкие состояния лежат в конце; из них — с меньшим числом
+    // ящиков на целях, среди равных — случайное
+    int deepest = depth[count - 1], first = count - 1;
+    while (first > 0 && depth[first - 1] == deepest) first--;
+    int best_on_goal = nb + 1, num_best = 0, pick = -1;
+    for (int i = first; i < count; i++)
+    {
+        int on_goal = 0;
+        for (int b = 0; b < nb; b++)
+            if (BBTest(&ctx.masks.goals, states[i].boxes[b])) on_goal++;
+        if (on_goal < best_on_goal)
+        {
+            best_on_goal = on_goal;
+            num_best = 0;
+        }
+        if (on_goal == best_on_goal && RngInt(rng, ++num_best) == 0) pick = i;
+    }
+
+    // цепочка толчков: path[0] — выбранное состояние, path[k] — после k-го
+    // толчка; направление толчка записано у состояния, из которого он сделан
+    int num_pushes = 0;
+    path[0] = states[pick];
+    for (int i = pick; parent[i] >= 0; i = parent[i])
+    {
+        num_pushes++;
+        path[num_pushes] = states[parent[i]];
+        dirs[num_pushes] = dir[i];
+    }
+
+    for (int b = 0; b < nb; b++)
+        level->boxes[b] = (Position){path[0].boxes[b] % MAX_FIELD, path[0].boxes[b] / MAX_FIELD};
+
+    // игрок — в случайной клетке своей области
+    Bitboard free_cells = ctx.masks.floor;
+    for (int b = 0; b < nb; b++)
+        BBReset(&free_cells, path[0].boxes[b]);
+    Bitboard region = BBFlood(&free_cells, path[0].player, &ctx.masks);
+    int cell = RngInt(rng, BBCount(&region)), pos;
+    while ((pos = BBPop(&region)) >= 0 && cell-- > 0)
+        ;
+    level->player = (Position){pos % MAX_FIELD, pos / MAX_FIELD};
+
+    // ходы строит PushMoves от только что поставленного игрока
+    moves = (int *)malloc(sizeof(int) * ((size_t)num_pushes * MAX_FIELD * MAX_FIELD + 1));
+    int num_moves = moves ? PushMoves(&ctx, path, dirs, 0, num_pushes, moves) : -1;
+    if (num_moves < 0 || num_moves > LEVEL_SOLUTION_MAX) goto done;
+    for (int i = 0; i < num_moves; i++)
+        level->solution[i] = (uint8_t)moves[i];
+    level->solution_len = num_moves;
+    level->solve_pushes = num_pushes;
+    level->solve_expanded = count;
+    level->solve_ms = ElapsedMs(&t0);
+    ok = true;
+done:
+    free(states);
+    free(keys);
+    free(parent);
+    free(depth);
+    free(dir);
+    free(seen);
+    free(moves);
+    FreeSearch(&ctx);
+    return ok;
+}
+
+static Level GenerateWithRng(Difficulty difficulty, LevelRng *rng, const GenerateOptions *options)
+{ // generates one level; все случайные числа берутся из rng
     Level level = {0};
     level.difficulty = difficulty;
     level.undo_head = NULL;
@@ -244,19 +428,19 @@ Level GenerateLevel(Difficulty difficulty)
     {
         switch (difficulty) {
             case DIFF_EASY:
-                level.width = 9 + rand() % 3;
-                level.height = 9 + rand() % 3;
-                level.num_boxes = 3 + rand() % 2;
+                level.width = 9 + RngInt(rng, 3);
+                level.height = 9 + RngInt(rng, 3);
+                level.num_boxes = 3 + RngInt(rng, 2);
                 break;
             case DIFF_MEDIUM:
-                level.width = 11 + rand() % 2;
-                level.height = 11 + rand() % 2;
-                level.num_boxes = 5 + rand() % 2;
+                level.width = 11 + RngInt(rng, 2);
+                level.height = 11 + RngInt(rng, 2);
+                level.num_boxes = 5 + RngInt(rng, 2);
                 break;
             case DIFF_HARD:
-                level.width = 13 + rand() % 2;
-                level.height = 13 + rand() % 2;
-                level.num_boxes = 7 + rand() % 2;
+                level.width = 13 + RngInt(rng, 2);
+                level.height = 13 + RngInt(rng, 2);
+                level.num_boxes = 7 + RngInt(rng, 2);
                 break;
         }
  
@@ -264,14 +448,14 @@ Level GenerateLevel(Difficulty difficulty)
             for (size_t j = 0; j < level.width; j++)
                 level.cells[i][j] = CELL_WALL;
  
-        GenerateMaze(&level);
+        GenerateMaze(&level, rng);
  
-        if (!PlaceGoalsAndBoxes(&level)) continue;
+        if (!PlaceGoalsAndBoxes(&level, rng)) continue;
  
         int player_placed = 0;
         for (int a = 0; a < 500 && !player_placed; a++) {
-            int px = 1 + rand() % (level.width - 2);
-            int py = 1 + rand() % (level.height - 2);
+            int px = 1 + RngInt(rng, level.width - 2);
+            int py = 1 + RngInt(rng, level.height - 2);
             if (level.cells[py][px] == CELL_FLOOR && !HasBox(&level, px, py))
             {
                 level.player.x = px; level.player.y = py;
@@ -280,17 +464,33 @@ Level GenerateLevel(Difficulty difficulty)
         }
         if (!player_placed) continue;
  
-        int target_moves = (difficulty == DIFF_EASY) ? 30 : (difficulty == DIFF_MEDIUM ? 60 : 100);
-        ReverseSolve(&level, target_moves);
+        bool bfs = options && options->mode == GEN_REVERSE_BFS;
+        if (bfs)
+        {
+            int max_states = options->max_states > 0 ? options->max_states : LEVEL_BFS_STATES;
+            if (!ReverseBfs(&level, max_states, rng)) continue;
+        }
+        else
+        {
+            int target_moves = (difficulty == DIFF_EASY) ? 30 : (difficulty == DIFF_MEDIUM ? 60 : 100);
+            ReverseSolve(&level, target_moves, rng);
+        }
  
         int boxes_on_goals = 0;
         for (int i = 0; i < level.num_boxes; i++)
         {
             if (IsOnGoal(&level, level.boxes[i])) boxes_on_goals++;
         }
-        if (boxes_on_goals > 0) continue;
+        if (boxes_on_goals > 0)
+        {
+            level.solution_len = 0;
+            continue;
+        }
  
-        if (HasDeadlock(&level)) continue;
+        // состояния обхода решаемы по построению
+        PushTable pt;
+        BuildPushTable(&level, &pt);
+        if (!bfs && HasDeadlock(&level, &pt)) continue;
  
         level.initial_state.player = level.player;
         memcpy(level.initial_state.boxes, level.boxes, sizeof(level.boxes));
@@ -301,7 +501,128 @@ Level GenerateLevel(Difficulty difficulty)
  
     return level;
 }
+
+// GenerateLevel: вызовы за одну секунду тоже дают разные уровни
+static atomic_uint_fast64_t s_generate_calls;
+
+static uint64_t ClockSeed(void)
+{ // seed from the realtime clock in ns and a per-process call counter
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    uint64_t calls = atomic_fetch_add(&s_generate_calls, 1);
+    return ((uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec) ^ (calls * 0x9e3779b97f4a7c15ULL);
+}
+
+static Level GenerateWithOptions(Difficulty difficulty, LevelRng *rng, const GenerateOptions *options)
+{ // candidates until A* solves one within the budget (без бюджета или с готовым решением — первый)
+    Level level = GenerateWithRng(difficulty, rng, options);
+    if (!options || (options->max_nodes <= 0 && options->time_limit_ms <= 0)) return level;
+
+    int tries = options->max_tries > 0 ? options->max_tries : LEVEL_BUDGET_TRIES;
+    for (int t = 0; level.solution_len == 0; t++)
+    {
+        SolverOptions opt = {.max_nodes = options->max_nodes, .time_limit_ms = options->time_limit_ms};
+        Solver solver = {0};
+        SolverStats st = {0};
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        SolveResult res = SolveLevelEx(&level, &solver, &opt, &st);
+        level.solve_ms = ElapsedMs(&t0);
+        level.solve_expanded = st.expanded;
+        level.solve_rejected = t;
+        if (res == SOLVE_FOUND)
+        {
+            level.solve_pushes = st.pushes;
+            FreeSolver(&solver);
+            return level;
+        }
+        // кандидаты кончились — отдаём последний с solve_pushes = 0
+        if (t + 1 >= tries) return level;
+        level = GenerateWithRng(difficulty, rng, options);
+    }
+    return level;
+}
+
+Level GenerateLevelSeeded(Difficulty difficulty, uint64_t seed, const GenerateOptions *options)
+{ // one level from a seed: одинаковый на любой платформе, ГПСЧ не зависит от libc
+    LevelRng rng;
+    RngSeed(&rng, seed);
+    Level level = GenerateWithOptions(difficulty, &rng, options);
+    level.seed = seed;
+    return level;
+}
+
+Level GenerateLevel(Difficulty difficulty, const GenerateOptions *options)
+{ // one level, seeded from the clock (зерно сохраняется в level.seed)
+    return GenerateLevelSeeded(difficulty, ClockSeed(), options);
+}
+
+static void *BatchWorker(void *arg)
+{ // batch thread: забирает номера уровней, пока они не кончатся
+    LevelWorker *w = (LevelWorker *)arg;
+    LevelBatch *b = w->batch;
+    int i;
+    while ((i = atomic_fetch_add(&b->next, 1)) < b->count)
+    {
+        uint64_t seed = b->first_seed + (uint64_t)i;
+        RngSeed(&w->rng, seed);
+        b->out[i] = GenerateWithOptions(b->difficulty, &w->rng, b->options);
+        b->out[i].seed = seed;
+    }
+    return NULL;
+}
+
+void GenerateLevelsSeeded(Difficulty difficulty, Level *out, int count, uint64_t first_seed,
+                          int threads, const GenerateOptions *options)
+{ // levels from seeds first_seed .. first_seed + count - 1 on a pool of threads (<= 0 — по числу ядер);
+  // результат не зависит от числа потоков
+    if (count <= 0) return;
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > LEVEL_MAX_THREADS) threads = LEVEL_MAX_THREADS;
+    if (threads > count) threads = count;
+
+    LevelBatch batch = {.difficulty = difficulty, .out = out, .count = count, .first_seed = first_seed,
+                        .options = options};
+    atomic_init(&batch.next, 0);
+
+    // у каждого потока своё состояние ГПСЧ, перед уровнем оно засевается его зерном
+    LevelWorker workers[LEVEL_MAX_THREADS];
+    for (int t = 0; t < threads; t++)
+        workers[t].batch = &batch;
+
+    pthread_t tids[LEVEL_MAX_THREADS];
+    int started = 0;
+    for (; started < threads; started++)
+        if (pthread_create(&tids[started], NULL, BatchWorker, &workers[started]) != 0) break;
+
+    // потоки не создались — генерируем сами
+    if (started == 0) BatchWorker(&workers[0]);
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+}
+
+void GenerateLevels(Difficulty difficulty, Level *out, int count, int threads,
+                    const GenerateOptions *options)
+{ // batch seeded from the clock
+    GenerateLevelsSeeded(difficulty, out, count, ClockSeed(), threads, options);
+}
  
+bool LevelSolution(const Level *level, Solver *solver)
+{ // готовое решение генератора в solver; false — решения нет (ходы — от initial_state)
+    if (level->solution_len <= 0) return false;
+    int *moves = (int *)malloc(sizeof(int) * level->solution_len);
+    if (!moves) return false;
+    for (int i = 0; i < level->solution_len; i++)
+        moves[i] = level->solution[i];
+    solver->moves = moves;
+    solver->num_moves = level->solution_len;
+    solver->current_move = 0;
+    solver->timer = 0;
+    solver->active = true;
+    return true;
+}
+
 void RestartLevel(Level *level)
 {
     FreeUndoStack(level);
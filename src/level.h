@@ -3,7 +3,17 @@
 
 #include "types.h"
 
-Level GenerateLevel(Difficulty difficulty);
+#define LEVEL_MAX_THREADS 64 // потоков пакетной генерации не больше
+#define LEVEL_BUDGET_TRIES 32 // кандидатов на уровень при генерации с бюджетом решения
+#define LEVEL_BFS_STATES 50000 // состояний в обходе GEN_REVERSE_BFS по умолчанию
+
+Level GenerateLevel(Difficulty difficulty, const GenerateOptions *options);
+Level GenerateLevelSeeded(Difficulty difficulty, uint64_t seed, const GenerateOptions *options);
+void GenerateLevels(Difficulty difficulty, Level *out, int count, int threads,
+                    const GenerateOptions *options);
+void GenerateLevelsSeeded(Difficulty difficulty, Level *out, int count, uint64_t first_seed,
+                          int threads, const GenerateOptions *options);
+bool LevelSolution(const Level *level, Solver *solver);
 void RestartLevel(Level *level);
 
 #endif
\ No newline at end of file
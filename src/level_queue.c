@@ -0,0 +1,181 @@
+/*
+ * level_queue.c — готовые уровни про запас.
+ *
+ * Трудный уровень генерируется до секунды с лишним; если строить его по
+ * нажатию кнопки, окно на это время замирает. Здесь фоновый поток держит
+ * по каждой сложности очередь из LEVEL_QUEUE_DEPTH готовых уровней и
+ * пополняет её, пока игрок сидит в меню или играет. Выбор сложности
+ * забирает уровень из очереди за O(1); только если очередь пуста (игрок
+ * прощёлкивает уровни быстрее генератора), уровень строится на месте, как
+ * раньше. Попадания и промахи считаются (LevelQueueStats).
+ *
+ * Уровни строятся обходом в ширину притягиваниями (GEN_REVERSE_BFS) и
+ * приходят с готовым оптимальным решением: Ctrl+B с начальной позиции
+ * проигрывает его без поиска, а число толчков известно заранее
+ * (Level.solve_pushes).
+ *
+ * Поток спит на условной переменной, когда все очереди полны, и
+ * просыпается, когда уровень забрали. Генерация идёт без блокировки, под
+ * мьютексом только кладётся готовый уровень.
+ */
+
+#include "level_queue.h"
+#include "level.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const char *s_diff_names[] = {"easy", "medium", "hard"};
+static FILE *s_gen_log = NULL; // открывается до запуска потока
+
+/*
+ * GenerateLogged — уровень сложности d с готовым решением; время
+ * генерации, зерно и цена решения дописываются в tests/test_gen.txt.
+ * Зовётся из фонового потока и при промахе из главного: fprintf на один
+ * FILE потокобезопасен.
+ */
+static Level GenerateLogged(Difficulty d)
+{
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    GenerateOptions options = {.mode = GEN_REVERSE_BFS};
+    Level lvl = GenerateLevel(d, &options);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+    if (s_gen_log)
+    {
+        fprintf(s_gen_log, "%s;%d;%.2f;%llu;%.2f;%lld;%d;%d\n", s_diff_names[d], lvl.num_boxes, ms,
+                (unsigned long long)lvl.seed, lvl.solve_ms, lvl.solve_expanded, lvl.solve_rejected,
+                lvl.solve_pushes);
+        fflush(s_gen_log);
+    }
+    return lvl;
+}
+
+/*
+ * NextToFill — сложность, очередь которой пополнять следующей: самая
+ * пустая, при равенстве — последняя взятая (игрок обычно её и повторяет).
+ * -1 — все очереди полны. Вызывается под q->lock.
+ */
+static int NextToFill(const LevelQueue *q)
+{
+    int best = -1;
+    for (int d = 0; d < 3; d++)
+    {
+        if (q->count[d] >= LEVEL_QUEUE_DEPTH) continue;
+        if (best < 0 || q->count[d] < q->count[best] ||
+            (q->count[d] == q->count[best] && d == (int)q->last))
+            best = d;
+    }
+    return best;
+}
+
+/* QueueThread — тело фонового потока: пополняет очереди, пока не stop. */
+static void *QueueThread(void *arg)
+{
+    LevelQueue *q = (LevelQueue *)arg;
+    pthread_mutex_lock(&q->lock);
+    while (!q->stop)
+    {
+        int d = NextToFill(q);
+        if (d < 0)
+        {
+            pthread_cond_wait(&q->wake, &q->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&q->lock);
+
+        Level lvl = GenerateLogged((Difficulty)d);
+        atomic_fetch_add(&q->generated, 1);
+
+        pthread_mutex_lock(&q->lock);
+        if (q->count[d] < LEVEL_QUEUE_DEPTH)
+        {
+            q->ready[d][(q->head[d] + q->count[d]) % LEVEL_QUEUE_DEPTH] = lvl;
+            q->count[d]++;
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+/*
+ * StartLevelQueue — запускает фоновое пополнение очередей. Если поток не
+ * создался, возвращает false; TakeLevel тогда просто строит уровни на
+ * месте.
+ */
+bool StartLevelQueue(LevelQueue *q)
+{
+    memset(q, 0, sizeof(*q));
+    if (!s_gen_log) s_gen_log = fopen("../tests/test_gen.txt", "a");
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wake, NULL);
+    atomic_init(&q->hits, 0);
+    atomic_init(&q->misses, 0);
+    atomic_init(&q->generated, 0);
+
+    if (pthread_create(&q->thread, NULL, QueueThread, q) != 0)
+        return false;
+    q->running = true;
+    return true;
+}
+
+/*
+ * TakeLevel — готовый уровень сложности d из очереди; если она пуста,
+ * уровень строится в вызывающем потоке. Взятое место поток пополнит.
+ */
+Level TakeLevel(LevelQueue *q, Difficulty d)
+{
+    if (q->running)
+    {
+        pthread_mutex_lock(&q->lock);
+        q->last = d;
+        if (q->count[d] > 0)
+        {
+            Level lvl = q->ready[d][q->head[d]];
+            q->head[d] = (q->head[d] + 1) % LEVEL_QUEUE_DEPTH;
+            q->count[d]--;
+            pthread_cond_signal(&q->wake);
+            pthread_mutex_unlock(&q->lock);
+            atomic_fetch_add(&q->hits, 1);
+            return lvl;
+        }
+        pthread_mutex_unlock(&q->lock);
+    }
+    atomic_fetch_add(&q->misses, 1);
+    return GenerateLogged(d);
+}
+
+/* GetLevelQueueStats — попадания, промахи и заполнение очередей. */
+LevelQueueStats GetLevelQueueStats(LevelQueue *q)
+{
+    LevelQueueStats st = {
+        .hits = atomic_load(&q->hits),
+        .misses = atomic_load(&q->misses),
+        .generated = atomic_load(&q->generated),
+    };
+    if (q->running) pthread_mutex_lock(&q->lock);
+    for (int d = 0; d < 3; d++)
+        st.ready[d] = q->count[d];
+    if (q->running) pthread_mutex_unlock(&q->lock);
+    return st;
+}
+
+/*
+ * StopLevelQueue — останавливает поток. Уровень, который он строит в этот
+ * момент, достраивается, поэтому выход может занять время одной
+ * генерации.
+ */
+void StopLevelQueue(LevelQueue *q)
+{
+    if (!q->running) return;
+    pthread_mutex_lock(&q->lock);
+    q->stop = true;
+    pthread_cond_signal(&q->wake);
+    pthread_mutex_unlock(&q->lock);
+    pthread_join(q->thread, NULL);
+    q->running = false;
+    pthread_cond_destroy(&q->wake);
+    pthread_mutex_destroy(&q->lock);
+}
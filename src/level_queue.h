@@ -0,0 +1,11 @@
+#ifndef LEVEL_QUEUE_H
+#define LEVEL_QUEUE_H
+
+#include "types.h"
+
+bool StartLevelQueue(LevelQueue *q);
+Level TakeLevel(LevelQueue *q, Difficulty d);
+LevelQueueStats GetLevelQueueStats(LevelQueue *q);
+void StopLevelQueue(LevelQueue *q);
+
+#endif
@@ -6,11 +6,40 @@
 #include "ui.h"
 #include "db.h"
 #include "solver.h"
+#include "solve_job.h"
+#include "level_queue.h"
 #include <stdlib.h>
 #include <stdio.h>
-#include <time.h>
 
 #define SOLVER_STEP_INTERVAL 0.12f
+#define AI_TIME_BUDGET_MS    1500.0 // anytime-поиск по Ctrl+B: улучшать решение не дольше
+
+/* IsMoveKeyPressed — нажата клавиша хода, отмены или перезапуска. */
+static bool IsMoveKeyPressed(void)
+{
+    return IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_DOWN) ||
+           IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_RIGHT) ||
+           IsKeyPressed(KEY_W) || IsKeyPressed(KEY_A) ||
+           IsKeyPressed(KEY_S) || IsKeyPressed(KEY_D) ||
+           IsKeyPressed(KEY_Z) || IsKeyPressed(KEY_R);
+}
+
+/*
+ * LogSolveTime — дописывает время решения в tests/test_solver.txt; по
+ * зерну медленный уровень повторяется через GenerateLevelSeeded.
+ */
+static void LogSolveTime(Difficulty diff, int num_boxes, double ms, uint64_t seed)
+{
+    static const char *diff_names[] = {"easy", "medium", "hard"};
+    static FILE *solver_log = NULL;
+    if (!solver_log) solver_log = fopen("../tests/test_solver.txt", "a");
+    if (solver_log)
+    {
+        fprintf(solver_log, "%s;%d;%.2f;%llu\n", diff_names[diff], num_boxes, ms,
+                (unsigned long long)seed);
+        fflush(solver_log);
+    }
+}
 
 int main(void)
 {
@@ -26,12 +55,19 @@ int main(void)
 
     Music *current_music = &music_menu;
 
-    open("sokoban.db");
+    db_open("sokoban.db");
+
+    // Уровни генерируются в фоне про запас: выбор сложности не ждёт генератора
+    LevelQueue queue;
+    StartLevelQueue(&queue);
 
     Screen screen = SCREEN_LOGIN;
     Difficulty diff = DIFF_EASY;
     Level level = {0};
     Solver solver = {0};
+    SolveJob job = {0};
+    uint64_t job_hash = 0; // отпечаток уровня, который решает job
+    SolverMemo memo = {0}; // анализ и последнее решение уровня; пока идёт job, его трогает только он
     int quit = 0;
     int user_id = -1;
     char username[64] = {0};
@@ -42,7 +78,24 @@ int main(void)
         {
             level.time_elapsed += GetFrameTime();
 
-            if (IsKeyPressed(KEY_ESCAPE))
+            if (job.running)
+            {
+                // Поиск идёт в фоне; ESC или ход прерывают его
+                if (SolveJobDone(&job))
+                {
+                    LogSolveTime(diff, level.num_boxes, job.elapsed_ms, level.seed);
+                    if (job.result == SOLVE_FOUND)
+                    {
+                        solver = job.solver;
+                        save_solution(job_hash, &solver, job.elapsed_ms, job.stats.expanded);
+                    }
+                }
+                else if (IsKeyPressed(KEY_ESCAPE) || IsMoveKeyPressed())
+                {
+                    CancelSolveJob(&job);
+                }
+            }
+            else if (IsKeyPressed(KEY_ESCAPE))
             {
                 if (solver.active) FreeSolver(&solver);
                 screen = SCREEN_PAUSE;
@@ -68,11 +121,7 @@ int main(void)
                     }
                 }
 
-                if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_DOWN) ||
-                    IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_RIGHT) ||
-                    IsKeyPressed(KEY_W) || IsKeyPressed(KEY_A) ||
-                    IsKeyPressed(KEY_S) || IsKeyPressed(KEY_D) ||
-                    IsKeyPressed(KEY_Z) || IsKeyPressed(KEY_R))
+                if (IsMoveKeyPressed())
                 {
                     FreeSolver(&solver);
                 }
@@ -83,23 +132,31 @@ int main(void)
                            IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
                 if (mod && IsKeyPressed(KEY_B))
                 {
-                    RestartLevel(&level);
+                    // Решается текущая позиция: ходы игрока сохраняются.
+                    // С начальной позиции проигрывается решение, которое
+                    // генератор построил вместе с уровнем (оно оптимально).
+                    // Решение из кэша проигрывается сразу, если оно
+                    // действительно проходит уровень; иначе — поиск (с
+                    // готовым анализом уровня и остатком прошлого решения
+                    // из memo). Поиск anytime: первое решение находится за
+                    // десятки миллисекунд и улучшается до доказанного
+                    // оптимума или до AI_TIME_BUDGET_MS. С Shift — IDA*:
+                    // всегда оптимально, в фиксированной памяти; кэш тогда
+                    // пропускается — в нём может лежать решение anytime
+                    bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+                    job_hash = level_fingerprint(&level);
+                    if (LevelSolution(&level, &solver) &&
+                        !CheckSolution(&level, solver.moves, solver.num_moves))
+                        FreeSolver(&solver);
+                    if (!solver.active && !shift && load_solution(job_hash, &solver, NULL, NULL) &&
+                        !CheckSolution(&level, solver.moves, solver.num_moves))
+                        FreeSolver(&solver);
+                    if (!solver.active)
                     {
-                        static const char *diff_names[] = {"easy", "medium", "hard"};
-                        static FILE *solver_log = NULL;
-                        struct timespec _t0, _t1;
-                        clock_gettime(CLOCK_MONOTONIC, &_t0);
-                        SolveLevel(&level, &solver);
-                        clock_gettime(CLOCK_MONOTONIC, &_t1);
-                        double _ms = (_t1.tv_sec - _t0.tv_sec) * 1000.0 +
-                                     (_t1.tv_nsec - _t0.tv_nsec) / 1e6;
-                        if (!solver_log) solver_log = fopen("../tests/test_solver.txt", "a");
-                        if (solver_log)
-                        {
-                            fprintf(solver_log, "%s;%d;%.2f\n",
-                                    diff_names[diff], level.num_boxes, _ms);
-                            fflush(solver_log);
-                        }
+                        SolverOptions opt = {.algorithm = shift ? SOLVER_IDA : SOLVER_ANYTIME,
+                                             .time_limit_ms = shift ? 0 : AI_TIME_BUDGET_MS,
+                                             .memo = &memo};
+                        StartSolveJob(&job, &level, &opt);
                     }
                 }
 
@@ -141,14 +198,29 @@ int main(void)
             DrawMenu(&screen, &quit, username);
             break;
         case SCREEN_DIFFICULTY:
-            DrawDifficultySelect(&screen, &diff, &level);
+            DrawDifficultySelect(&screen, &diff, &level, &queue);
             break;
         case SCREEN_SETTINGS:
             DrawSettings(&screen);
             break;
         case SCREEN_GAME:
             RenderLevel(&level);
-            if (solver.active)
+            if (job.running)
+            {
+                int best = atomic_load(&job.progress.best_pushes);
+                const char *stxt = best > 0
+                    ? TextFormat("AI IMPROVING  %d pushes (optimum >= %d)  nodes %lld  (ESC - cancel)", best,
+                                 atomic_load(&job.progress.lower_bound),
+                                 (long long)atomic_load(&job.progress.expanded))
+                    : TextFormat("AI SEARCHING  nodes %lld  open %d  f %d  (ESC - cancel)",
+                                 (long long)atomic_load(&job.progress.expanded),
+                                 atomic_load(&job.progress.frontier),
+                                 atomic_load(&job.progress.f_bound));
+                int stw = MeasureText(stxt, 20);
+                DrawText(stxt, GetScreenWidth() / 2 - stw / 2, GetScreenHeight() - 36, 20,
+                         CLITERAL(Color){200, 180, 110, 255});
+            }
+            else if (solver.active)
             {
                 const char *stxt = TextFormat("AI SOLVING  %d/%d", solver.current_move, solver.num_moves);
                 int stw = MeasureText(stxt, 20);
@@ -162,7 +234,7 @@ int main(void)
             break;
         case SCREEN_WIN:
             RenderLevel(&level);
-            DrawWin(&screen, &level, diff);
+            DrawWin(&screen, &level, diff, &queue);
             break;
         case SCREEN_RULES:
             DrawRules(&screen);
@@ -177,9 +249,14 @@ int main(void)
         EndDrawing();
     }
 
+    CancelSolveJob(&job);
+    StopLevelQueue(&queue);
+    LevelQueueStats qs = GetLevelQueueStats(&queue);
+    printf("[levels] queue hits %lld, misses %lld, generated %lld\n", qs.hits, qs.misses, qs.generated);
+    FreeSolverMemo(&memo);
     if (solver.active) FreeSolver(&solver);
     FreeUndoStack(&level);
-    close();
+    db_close();
 
     UnloadMusicStream(music_menu);
     UnloadMusicStream(music_game);
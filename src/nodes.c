@@ -0,0 +1,366 @@
+/*
+ * nodes.c — хранилища узлов поиска по толчкам, общие для A* (solver.c) и
+ * многопоточного HDA* (hda.c; там у каждого потока свой набор):
+ *
+ *   NodePool    — все порождённые узлы, блоками постоянного размера.
+ *                 Каждый узел хранит ключ состояния, ссылку на родителя,
+ *                 направление толчка и значения g, f. Состояние хранится рядом
+ *                 только при неточных ключах (Zobrist), иначе оно
+ *                 восстанавливается из ключа.
+ *   BucketQueue — корзины по f, внутри — стеки по g; хранит индексы в
+ *                 NodePool. Это «открытый список» (open list) A*.
+ *   HashSet     — хеш-таблица с открытой адресацией по ключам состояний;
+ *                 хранит индексы узлов из NodePool. Это «закрытый список»
+ *                 (closed list) A* — уже встреченные состояния с лучшим
+ *                 известным g.
+ */
+
+#include "nodes.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- Начальные размеры ---------- */
+
+/*
+ * InitialHashCap — начальная ёмкость хеш-таблицы (делится на parts
+ * потоков). При лимите памяти max_bytes (0 — без лимита) таблица
+ * стартует не больше чем с четверти лимита, чтобы маленький лимит не
+ * исчерпывался ещё до первого раскрытия. Пул отдельного начального
+ * размера не имеет — он растёт блоками.
+ */
+int InitialHashCap(long long max_bytes, int parts)
+{
+    int hash = HASH_INIT_CAP;
+    while (hash > 4096 && (long long)hash * parts > HASH_INIT_CAP)
+        hash >>= 1;
+
+    if (max_bytes > 0)
+    {
+        long long share = max_bytes / 4 / parts;
+        while (hash > 1024 && (long long)hash * (long long)(sizeof(uint64_t) + sizeof(int)) > share)
+            hash >>= 1;
+    }
+    return hash;
+}
+
+/* ---------- NodePool — пул узлов A* ---------- */
+
+/*
+ * Узлы лежат в блоках по POOL_CHUNK штук; таблица блоков выделяется
+ * сразу на весь лимит узлов, поэтому рост — это malloc ещё одного блока:
+ * уже созданные узлы не копируются, их адреса не меняются, и лишней
+ * копии массива на время роста не нужно. Узел адресуется
+ * целочисленным индексом (PoolNode: номер блока и смещение в нём), поле
+ * parent в AStarNode — тоже индекс.
+ */
+
+/* ChunkBytes — байт на один блок пула (вместе с блоком состояний, если он есть). */
+static long long ChunkBytes(const NodePool *p)
+{
+    long long node = (long long)sizeof(AStarNode) + (p->states ? (long long)sizeof(PackedState) : 0);
+    return node * POOL_CHUNK;
+}
+
+/*
+ * CreateNodePool — пустой пул не больше чем на limit узлов.
+ * keep_states — хранить состояния узлов (нужно, если ключи неточные).
+ */
+NodePool *CreateNodePool(int limit, bool keep_states)
+{
+    NodePool *p = (NodePool *)calloc(1, sizeof(NodePool));
+    if (!p) return NULL;
+    p->max_chunks = (limit + POOL_CHUNK - 1) / POOL_CHUNK;
+    p->chunks = (AStarNode **)calloc(p->max_chunks, sizeof(AStarNode *));
+    if (keep_states) p->states = (PackedState **)calloc(p->max_chunks, sizeof(PackedState *));
+    if (!p->chunks || (keep_states && !p->states))
+    {
+        FreeNodePool(p);
+        return NULL;
+    }
+    p->bytes = (long long)sizeof(void *) * p->max_chunks * (keep_states ? 2 : 1);
+    return p;
+}
+
+/* FreeNodePool — освобождает все блоки пула разом. */
+void FreeNodePool(NodePool *p)
+{
+    if (!p) return;
+    for (int i = 0; i < p->num_chunks; i++)
+    {
+        free(p->chunks[i]);
+        if (p->states) free(p->states[i]);
+    }
+    free(p->chunks);
+    free(p->states);
+    free(p);
+}
+
+/*
+ * PoolAdd — добавляет узел с состоянием state в пул, при необходимости
+ * выделяя новый блок. Состояние копируется, только если пул хранит
+ * состояния. Возвращает индекс нового узла или -1 при ошибке.
+ */
+int PoolAdd(NodePool *p, const AStarNode *node, const PackedState *state)
+{
+    if (p->count == p->num_chunks * POOL_CHUNK)
+    {
+        if (p->num_chunks >= p->max_chunks) return -1;
+        AStarNode *chunk = (AStarNode *)malloc(sizeof(AStarNode) * POOL_CHUNK);
+        if (!chunk) return -1;
+        if (p->states)
+        {
+            PackedState *st = (PackedState *)malloc(sizeof(PackedState) * POOL_CHUNK);
+            if (!st) { free(chunk); return -1; }
+            p->states[p->num_chunks] = st;
+        }
+        p->chunks[p->num_chunks++] = chunk;
+        p->bytes += ChunkBytes(p);
+    }
+    *PoolNode(p, p->count) = *node;
+    if (p->states) *PoolState(p, p->count) = *state;
+    return p->count++;
+}
+
+/*
+ * PoolGrowthBytes — сколько байт добавит следующий PoolAdd (0, если место
+ * есть): по нему лимит памяти проверяется до выделения блока, а не после.
+ */
+long long PoolGrowthBytes(const NodePool *p)
+{
+    if (p->count < p->num_chunks * POOL_CHUNK || p->num_chunks >= p->max_chunks) return 0;
+    return ChunkBytes(p);
+}
+
+/* ---------- BucketQueue — приоритетная очередь (open list) ---------- */
+
+/*
+ * Значения f — небольшие целые (не больше нескольких сотен толчков),
+ * поэтому вместо кучи узлы раскладываются по корзинам: buckets[f] —
+ * узлы с этим f, внутри корзины — стеки by_g[g]. Вставка — дописать
+ * индекс в конец стека, извлечение — снять с конца стека наименьшего f и
+ * наибольшего g. Обе операции O(1) (не считая сдвига курсоров) и не
+ * читают узлы из пула, в отличие от сравнений f в куче.
+ *
+ * При равном f раскрывается узел с большим g: он глубже и ближе к цели
+ * по оценке h = f - g. Эвристика согласована (толчок уменьшает h не
+ * больше чем на 1), поэтому f дочернего узла не меньше f родителя, и
+ * курсор min_f почти всегда движется только вперёд.
+ */
+
+void FreeBucketQueue(BucketQueue *q)
+{
+    if (!q) return;
+    for (int f = 0; f < q->num_buckets; f++)
+    {
+        for (int g = 0; g < q->buckets[f].num_g; g++)
+            free(q->buckets[f].by_g[g].idx);
+        free(q->buckets[f].by_g);
+    }
+    free(q->buckets);
+    free(q);
+}
+
+BucketQueue *CreateBucketQueue(void)
+{
+    return (BucketQueue *)calloc(1, sizeof(BucketQueue));
+}
+
+/*
+ * GrowArray — увеличивает массив *data из *count элементов размера size
+ * минимум до need элементов (с запасом ×2), новые элементы обнуляются.
+ * Рост учитывается в счётчиках очереди q.
+ */
+static int GrowArray(BucketQueue *q, void **data, int *count, int need, size_t size)
+{
+    int new_count = *count ? *count : 16;
+    while (new_count < need) new_count *= 2;
+    void *tmp = realloc(*data, size * new_count);
+    if (!tmp) return 0;
+    memset((char *)tmp + size * *count, 0, size * (new_count - *count));
+    q->bytes += (long long)size * (new_count - *count);
+    q->reallocs++;
+    *data = tmp;
+    *count = new_count;
+    return 1;
+}
+
+/* BucketPush — добавляет индекс узла с данными f и g; 0 — нет памяти. */
+int BucketPush(BucketQueue *q, int f, int g, int node_idx)
+{
+    if (f >= q->num_buckets &&
+        !GrowArray(q, (void **)&q->buckets, &q->num_buckets, f + 1, sizeof(FBucket)))
+        return 0;
+    FBucket *b = &q->buckets[f];
+    if (g >= b->num_g &&
+        !GrowArray(q, (void **)&b->by_g, &b->num_g, g + 1, sizeof(IndexStack)))
+        return 0;
+    IndexStack *st = &b->by_g[g];
+    if (st->size >= st->capacity &&
+        !GrowArray(q, (void **)&st->idx, &st->capacity, st->size + 1, sizeof(int)))
+        return 0;
+
+    st->idx[st->size++] = node_idx;
+    b->count++;
+    if (g > b->top_g) b->top_g = g;
+    if (f < q->min_f || q->size == 0) q->min_f = f;
+    q->size++;
+    return 1;
+}
+
+/* BucketPop — извлекает узел с наименьшим f, при равенстве — с наибольшим g. */
+int BucketPop(BucketQueue *q)
+{
+    if (q->size <= 0) return -1;
+    while (q->buckets[q->min_f].count == 0) q->min_f++;
+    FBucket *b = &q->buckets[q->min_f];
+    while (b->by_g[b->top_g].size == 0) b->top_g--;
+    b->count--;
+    q->size--;
+    IndexStack *st = &b->by_g[b->top_g];
+    return st->idx[--st->size];
+}
+
+/* ---------- HashSet — закрытый список посещённых состояний ---------- */
+
+/*
+ * Хеш-таблица с открытой адресацией (линейное зондирование).
+ * Ёмкость всегда степень двойки, поэтому вместо деления используется
+ * побитовое AND с mask = capacity - 1.
+ *
+ * В ячейке хранится ключ состояния и индекс узла в NodePool; пустая
+ * ячейка — ключ HASH_EMPTY (нулевой ключ записывается как UINT64_MAX,
+ * которого точные ключи не достигают), так что зондирование читает
+ * только массив ключей, а таблица выделяется calloc без заполнения.
+ * Точный ключ (ранг) однозначно задаёт состояние, и совпадения ключей
+ * достаточно; при ключах Zobrist полное состояние из пула сравнивается
+ * только при совпадении ключей. Так таблица работает как отображение
+ * «состояние → лучший известный узел»: если состояние встречено
+ * повторно с меньшим g, ячейка перенаправляется на новый узел, а старая
+ * копия в open list при извлечении пропускается.
+ */
+
+/* PackedEqual — побайтовое сравнение двух состояний. */
+static int PackedEqual(const PackedState *a, const PackedState *b, int nb)
+{
+    if (a->player != b->player) return 0;
+    for (int i = 0; i < nb; i++)
+        if (a->boxes[i] != b->boxes[i]) return 0;
+    return 1;
+}
+
+HashSet *CreateHashSet(int capacity)
+{
+    HashSet *hs = (HashSet *)calloc(1, sizeof(HashSet));
+    if (!hs) return NULL;
+    hs->keys = (uint64_t *)calloc(capacity, sizeof(uint64_t)); // все ячейки = HASH_EMPTY
+    hs->nodes = (int *)malloc(sizeof(int) * capacity);
+    if (!hs->keys || !hs->nodes)
+    {
+        free(hs->keys);
+        free(hs->nodes);
+        free(hs);
+        return NULL;
+    }
+    hs->capacity = capacity;
+    hs->mask = capacity - 1;
+    hs->bytes = (long long)(sizeof(uint64_t) + sizeof(int)) * capacity;
+    return hs;
+}
+
+void FreeHashSet(HashSet *hs)
+{
+    if (!hs) return;
+    free(hs->keys);
+    free(hs->nodes);
+    free(hs);
+}
+
+/*
+ * HashSetGrow — удваивает ёмкость таблицы и переносит все записи.
+ * Вызывается автоматически при заполнении >50% (load factor 0.5),
+ * чтобы сохранить скорость линейного зондирования. Ключи хранятся в
+ * таблице, поэтому состояния из пула не читаются и не перехешируются.
+ */
+int HashSetGrow(HashSet *hs)
+{
+    int new_cap = hs->capacity * 2;
+    uint64_t *new_keys = (uint64_t *)calloc(new_cap, sizeof(uint64_t));
+    int *new_nodes = (int *)malloc(sizeof(int) * new_cap);
+    if (!new_keys || !new_nodes)
+    {
+        free(new_keys);
+        free(new_nodes);
+        return 0;
+    }
+    int new_mask = new_cap - 1;
+    // Перенос всех существующих записей в новую таблицу
+    for (int i = 0; i < hs->capacity; i++)
+    {
+        if (hs->keys[i] == HASH_EMPTY) continue;
+        uint32_t idx = (uint32_t)MixKey(hs->keys[i]) & new_mask;
+        while (new_keys[idx] != HASH_EMPTY)
+        {
+            idx = (idx + 1) & new_mask; // линейное зондирование
+        }
+        new_keys[idx] = hs->keys[i];
+        new_nodes[idx] = hs->nodes[i];
+    }
+
+    free(hs->keys);
+    free(hs->nodes);
+    hs->keys = new_keys;
+    hs->nodes = new_nodes;
+    hs->bytes += (long long)(sizeof(uint64_t) + sizeof(int)) * (new_cap - hs->capacity);
+    hs->capacity = new_cap;
+    hs->mask = new_mask;
+    hs->rehashes++;
+    return 1;
+}
+
+/*
+ * HashSetGrowthBytes — сколько байт сверх уже выделенных (hs->bytes)
+ * займёт новая таблица, если следующая вставка вызовет удвоение.
+ */
+long long HashSetGrowthBytes(const HashSet *hs)
+{
+    if ((hs->count + 1) * 2 < hs->capacity) return 0;
+    return hs->bytes * 2;
+}
+
+/*
+ * HashSetFind — ищет состояние ps с ключом key в таблице.
+ * Возвращает индекс узла, если состояние уже встречалось, иначе -1.
+ * В *slot записывается ячейка найденной записи либо пустая ячейка,
+ * куда состояние можно вставить через HashSetPut.
+ *
+ * Линейное зондирование: если ячейка занята другим состоянием,
+ * переходим к следующей по кругу (idx+1) & mask. Если пул не хранит
+ * состояний, ключи точные, и состояния не сравниваются.
+ */
+int HashSetFind(const HashSet *hs, const NodePool *pool, uint64_t key,
+                const PackedState *ps, int nb, uint32_t *slot)
+{
+    if (key == HASH_EMPTY) key = UINT64_MAX;
+    uint32_t idx = (uint32_t)MixKey(key) & hs->mask;
+    while (hs->keys[idx] != HASH_EMPTY)
+    {
+        if (hs->keys[idx] == key &&
+            (!pool->states || PackedEqual(PoolState(pool, hs->nodes[idx]), ps, nb))) break; // уже есть
+        idx = (idx + 1) & hs->mask;
+    }
+    *slot = idx;
+    return hs->keys[idx] == HASH_EMPTY ? -1 : hs->nodes[idx];
+}
+
+/*
+ * HashSetPut — записывает узел node_idx в ячейку slot, полученную от
+ * HashSetFind. Если ячейка была пустой, число записей растёт; если в ней
+ * было то же состояние с худшим g — запись перенаправляется.
+ */
+void HashSetPut(HashSet *hs, uint32_t slot, uint64_t key, int node_idx)
+{
+    if (key == HASH_EMPTY) key = UINT64_MAX;
+    if (hs->keys[slot] == HASH_EMPTY) hs->count++;
+    hs->keys[slot] = key;
+    hs->nodes[slot] = node_idx;
+}
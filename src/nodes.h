@@ -0,0 +1,59 @@
+#ifndef NODES_H
+#define NODES_H
+
+#include "types.h"
+
+/* Начальные/максимальные ёмкости динамических структур. */
+#define NODES_MAX_CAP   100000000
+#define POOL_CHUNK_SHIFT 16
+#define POOL_CHUNK      (1 << POOL_CHUNK_SHIFT) // узлов в блоке пула
+#define HASH_INIT_CAP   1048576   // 2^20, степень двойки
+#define HASH_EMPTY      0         // ключ пустой ячейки HashSet (нулевой ключ хранится как UINT64_MAX)
+
+/*
+ * MixKey — перемешивание ключа перед выбором ячейки таблицы или потока.
+ * Ранги состояний идут подряд и в старших битах почти нулевые, поэтому
+ * брать из них биты напрямую нельзя (финализатор MurmurHash3).
+ */
+static inline uint64_t MixKey(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    return key ^ (key >> 33);
+}
+
+int InitialHashCap(long long max_bytes, int parts);
+
+/* PoolNode — узел idx пула; адрес не меняется до FreeNodePool. */
+static inline AStarNode *PoolNode(const NodePool *p, int idx)
+{
+    return &p->chunks[idx >> POOL_CHUNK_SHIFT][idx & (POOL_CHUNK - 1)];
+}
+
+/* PoolState — хранимое состояние узла idx (только если p->states != NULL). */
+static inline PackedState *PoolState(const NodePool *p, int idx)
+{
+    return &p->states[idx >> POOL_CHUNK_SHIFT][idx & (POOL_CHUNK - 1)];
+}
+
+NodePool *CreateNodePool(int limit, bool keep_states);
+void FreeNodePool(NodePool *p);
+int PoolAdd(NodePool *p, const AStarNode *node, const PackedState *state);
+long long PoolGrowthBytes(const NodePool *p);
+
+BucketQueue *CreateBucketQueue(void);
+void FreeBucketQueue(BucketQueue *q);
+int BucketPush(BucketQueue *q, int f, int g, int node_idx);
+int BucketPop(BucketQueue *q);
+
+HashSet *CreateHashSet(int capacity);
+void FreeHashSet(HashSet *hs);
+int HashSetGrow(HashSet *hs);
+long long HashSetGrowthBytes(const HashSet *hs);
+int HashSetFind(const HashSet *hs, const NodePool *pool, uint64_t key,
+                const PackedState *ps, int nb, uint32_t *slot);
+void HashSetPut(HashSet *hs, uint32_t slot, uint64_t key, int node_idx);
+
+#endif
@@ -0,0 +1,473 @@
+/*
+ * optimize.c — укорачивание готового решения.
+ *
+ * Взвешенный и anytime-поиск (solver.c), как и решения из повторов,
+ * дают корректный, но не кратчайший список ходов: игрок делает петли
+ * между толчками, ящики сдвигаются туда и обратно, отдельные участки
+ * решаются за лишние толчки. Воспроизведение показывает каждый шаг,
+ * поэтому все эти обходы видны.
+ *
+ * Список ходов проигрывается на копии уровня и превращается в цепочку
+ * толчков (состояния как у решателя: ящики отсортированы, игрок
+ * нормализован). Дальше три шага:
+ *   1. подходы к ящикам между толчками строятся заново кратчайшими
+ *      путями (PushMoves, search.c);
+ *   2. вырезаются петли — участки между двумя одинаковыми состояниями;
+ *   3. окна по OPTIMIZE_WINDOW толчков: поиском в ширину по толчкам от
+ *      начала окна ищется более короткий путь в одно из следующих
+ *      состояний цепочки (в последнем окне — в любое целевое). Замена
+ *      принимается, если шагов игрока на этом участке не стало больше.
+ * Окна перебираются проходами, пока цепочка укорачивается. Итог
+ * заменяет решение, только если он короче исходного по шагам.
+ */
+
+#include "optimize.h"
+#include "search.h"
+#include "solver.h"
+#include "nodes.h"
+#include "bitboard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int ODX[4] = {0, 0, -1, 1};
+static const int ODY[4] = {-1, 1, 0, 0};
+
+#define CELLS (MAX_FIELD * MAX_FIELD)
+
+/* SameState — два состояния совпадают (ящики и область игрока). */
+static bool SameState(const PackedState *a, const PackedState *b, int nb)
+{
+    return a->player == b->player && memcmp(a->boxes, b->boxes, sizeof(uint16_t) * nb) == 0;
+}
+
+/* Stopped — вышел срок или UI отменил задачу. */
+static bool Stopped(double deadline, const SolverProgress *progress)
+{
+    return (deadline > 0 && NowMs() >= deadline) ||
+           (progress && atomic_load(&progress->cancel));
+}
+
+/*
+ * ReplayPushes — проигрывает ходы на копии уровня и записывает состояние
+ * после каждого толчка в path[1..] (path[0] — старт) и его направление в
+ * dirs. Возвращает число толчков или -1, если ход упирается в стену или
+ * ящик либо решение не ставит ящики на цели.
+ */
+static int ReplayPushes(const SearchContext *ctx, const Level *level, const int *moves,
+                        int num_moves, PackedState *path, int *dirs)
+{
+    Level cur = *level;
+    int nb = level->num_boxes;
+    int n = 0;
+    path[0] = CurrentState(ctx, &cur);
+
+    for (int i = 0; i < num_moves; i++)
+    {
+        int d = moves[i] & 3;
+        int nx = cur.player.x + ODX[d];
+        int ny = cur.player.y + ODY[d];
+        if (nx < 0 || nx >= cur.width || ny < 0 || ny >= cur.height ||
+            cur.cells[ny][nx] == CELL_WALL)
+            return -1;
+
+        int box = -1;
+        for (int b = 0; b < nb; b++)
+            if (cur.boxes[b].x == nx && cur.boxes[b].y == ny) box = b;
+        if (box >= 0)
+        {
+            int bx = nx + ODX[d];
+            int by = ny + ODY[d];
+            if (bx < 0 || bx >= cur.width || by < 0 || by >= cur.height ||
+                cur.cells[by][bx] == CELL_WALL)
+                return -1;
+            for (int b = 0; b < nb; b++)
+                if (cur.boxes[b].x == bx && cur.boxes[b].y == by) return -1;
+            cur.boxes[box].x = bx;
+            cur.boxes[box].y = by;
+        }
+        cur.player.x = nx;
+        cur.player.y = ny;
+
+        if (box >= 0)
+        {
+            n++;
+            path[n] = CurrentState(ctx, &cur);
+            dirs[n] = d;
+        }
+    }
+    return IsGoalState(ctx, &path[n]) ? n : -1;
+}
+
+/*
+ * CutCycles — вырезает из цепочки path[0..n] участки между повторами
+ * одного состояния. Возвращает новое число толчков, вырезанные петли
+ * прибавляются к *cycles.
+ */
+static int CutCycles(PackedState *path, int *dirs, uint64_t *keys, int n, int nb, int *cycles)
+{
+    int m = 0;
+    for (int k = 1; k <= n; k++)
+    {
+        int j = m;
+        while (j >= 0 && !(keys[j] == keys[k] && SameState(&path[j], &path[k], nb)))
+            j--;
+        if (j >= 0)
+        {
+            m = j; // состояние уже было: толчки после него откатываются
+            (*cycles)++;
+            continue;
+        }
+        m++;
+        path[m] = path[k];
+        dirs[m] = dirs[k];
+        keys[m] = keys[k];
+    }
+    return m;
+}
+
+/*
+ * BuildDistances — шагов по полу между всеми парами клеток без учёта
+ * ящиков: dist[a * CELLS + b], 255 — недостижимо (или дальше).
+ */
+static void BuildDistances(const Level *level, uint8_t *dist)
+{
+    memset(dist, 255, CELLS * CELLS);
+    for (int from = 0; from < CELLS; from++)
+    {
+        int fx = from % MAX_FIELD, fy = from / MAX_FIELD;
+        if (fx >= level->width || fy >= level->height || level->cells[fy][fx] == CELL_WALL)
+            continue;
+        uint8_t *row = dist + from * CELLS;
+        uint16_t queue[CELLS];
+        int head = 0, tail = 0;
+        row[from] = 0;
+        queue[tail++] = (uint16_t)from;
+        while (head < tail)
+        {
+            int p = queue[head++];
+            int x = p % MAX_FIELD, y = p / MAX_FIELD;
+            for (int d = 0; d < 4; d++)
+            {
+                int nx = x + ODX[d], ny = y + ODY[d];
+                if (nx < 0 || nx >= level->width || ny < 0 || ny >= level->height ||
+                    level->cells[ny][nx] == CELL_WALL)
+                    continue;
+                int np = ny * MAX_FIELD + nx;
+                if (row[np] != 255) continue;
+                row[np] = row[p] < 254 ? (uint8_t)(row[p] + 1) : 254;
+                queue[tail++] = (uint16_t)np;
+            }
+        }
+    }
+}
+
+/*
+ * NearTable — near[c] = шагов от клетки c до ближайшей из клеток target
+ * (dist симметрична, поэтому это поэлементный минимум строк target).
+ */
+static void NearTable(const uint8_t *dist, const uint16_t *target, int nb, uint8_t *near)
+{
+    memset(near, 255, CELLS);
+    for (int t = 0; t < nb; t++)
+    {
+        const uint8_t *row = dist + target[t] * CELLS;
+        for (int c = 0; c < CELLS; c++)
+            if (row[c] < near[c]) near[c] = row[c];
+    }
+}
+
+/*
+ * Bound — нижняя оценка толчков от ящиков boxes до расстановки с
+ * таблицей near (NearTable): толчок сдвигает один ящик на клетку, а
+ * каждому ящику идти не меньше, чем до ближайшей клетки расстановки.
+ */
+static int Bound(const uint8_t *near, const uint16_t *boxes, int nb)
+{
+    int sum = 0;
+    for (int b = 0; b < nb; b++)
+        sum += near[boxes[b]];
+    return sum;
+}
+
+/* MovedFrom — клетка, с которой ушёл ящик при переходе parent -> child. */
+static uint16_t MovedFrom(const PackedState *parent, const PackedState *child, int nb)
+{
+    int j = 0;
+    for (int i = 0; i < nb; i++)
+    {
+        while (j < nb && child->boxes[j] < parent->boxes[i]) j++;
+        if (j == nb || child->boxes[j] != parent->boxes[i]) return parent->boxes[i];
+    }
+    return 0;
+}
+
+/*
+ * Shortcut — поиск в ширину по толчкам от path[i]: путь в одно из
+ * состояний path[i+2..end] короче, чем по цепочке (last — окно
+ * заканчивается решением, и подходит любое целевое состояние). Толкать
+ * можно только ящики, которые сдвигаются и в самом окне: остальные
+ * стоят на месте во всех его состояниях, и без них ветвление в разы
+ * меньше, а окно можно брать длиннее. Состояние, из которого по оценке
+ * Bound ни до одного состояния окна не дойти с экономией больше уже
+ * найденной, отбрасывается. Берётся путь с наибольшей экономией
+ * толчков; поиск останавливается, когда глубже экономия не вырастет или
+ * раскрыто max_nodes состояний. near — место под таблицы NearTable
+ * состояний окна (near + (t - i) * CELLS); в near[0..CELLS) уже лежит
+ * таблица клеток целей.
+ * Возвращает длину пути g (состояния в seg[1..g], направления в
+ * seg_dirs[1..g]) и в *target — номер состояния цепочки, в которое он
+ * приходит; 0 — короче не нашлось.
+ */
+static int Shortcut(const SearchContext *ctx, const uint8_t *dist, uint8_t *near, const PackedState *path,
+                    const uint64_t *keys, int i, int end, bool last, long long max_nodes,
+                    PackedState *seg, int *seg_dirs, int *target, long long *expanded)
+{
+    int nb = ctx->num_boxes;
+    long long limit = max_nodes * MAX_CHILDREN + 1;
+    NodePool *pool = CreateNodePool(limit < NODES_MAX_CAP ? (int)limit : NODES_MAX_CAP,
+                                    !ctx->ranks.exact);
+    HashSet *seen = CreateHashSet(4096);
+    SearchChild children[MAX_CHILDREN];
+    PruneStats prune = {0};
+    long long count = 0;
+    int best = 0, best_idx = -1;
+    if (!pool || !seen) goto done;
+
+    // Ящики, которые не сдвигаются на всём окне
+    uint8_t fixed[MAX_FIELD * MAX_FIELD] = {0};
+    for (int b = 0; b < nb; b++)
+        fixed[path[i].boxes[b]] = 1;
+    for (int k = i + 1; k <= end; k++)
+    {
+        uint8_t here[MAX_FIELD * MAX_FIELD] = {0};
+        for (int b = 0; b < nb; b++)
+            here[path[k].boxes[b]] = 1;
+        for (int b = 0; b < nb; b++)
+            fixed[path[i].boxes[b]] &= here[path[i].boxes[b]];
+    }
+    for (int t = i + 1; t <= end; t++)
+        NearTable(dist, path[t].boxes, nb, near + (t - i) * CELLS);
+
+    AStarNode root = {.key = keys[i], .parent = -1, .direction = -1};
+    uint32_t slot;
+    if (PoolAdd(pool, &root, &path[i]) < 0) goto done;
+    HashSetFind(seen, pool, root.key, &path[i], nb, &slot);
+    HashSetPut(seen, slot, root.key, 0);
+
+    // Узлы пула добавляются по слоям, поэтому сам пул — очередь обхода
+    for (int idx = 0; idx < pool->count && count < max_nodes; idx++)
+    {
+        const AStarNode *node = PoolNode(pool, idx);
+        int g = node->g + 1; // глубина потомков
+        if (i + g + best >= end) break; // глубже экономия не больше best
+
+        PackedState cur;
+        NodeState(ctx, pool, idx, &cur);
+        int num_children = ExpandState(ctx, &cur, node->key, children, &prune);
+        count++;
+        for (int c = 0; c < num_children; c++)
+        {
+            const SearchChild *ch = &children[c];
+            if (fixed[MovedFrom(&cur, &ch->state, nb)]) continue;
+            if (HashSetFind(seen, pool, ch->key, &ch->state, nb, &slot) >= 0) continue;
+
+            // Нужна хотя бы одна цель окна с экономией больше best
+            int hit = 0;
+            bool useful = false;
+            for (int t = end; t > i + g + best; t--)
+            {
+                int h = Bound(near + (t - i) * CELLS, ch->state.boxes, nb);
+                bool any_goal = t == end && last;
+                if (any_goal)
+                {
+                    int hg = Bound(near, ch->state.boxes, nb);
+                    if (hg < h) h = hg;
+                }
+                if (g + h >= t - i - best) continue;
+                useful = true;
+                if (h == 0 && ((keys[t] == ch->key && SameState(&path[t], &ch->state, nb)) ||
+                               (any_goal && IsGoalState(ctx, &ch->state))))
+                {
+                    hit = t;
+                    break;
+                }
+            }
+            if (!useful) continue;
+
+            AStarNode child = {.key = ch->key, .parent = idx, .g = g,
+                               .direction = (signed char)ch->direction};
+            int child_idx = PoolAdd(pool, &child, &ch->state);
+            if (child_idx < 0) goto done;
+            if (seen->count * 2 >= seen->capacity)
+            {
+                if (!HashSetGrow(seen)) goto done;
+                HashSetFind(seen, pool, ch->key, &ch->state, nb, &slot);
+            }
+            HashSetPut(seen, slot, ch->key, child_idx);
+
+            if (hit)
+            {
+                best = hit - i - g;
+                best_idx = child_idx;
+                *target = hit;
+            }
+        }
+    }
+
+done:
+    *expanded += count;
+    int g = 0;
+    if (best_idx >= 0)
+    {
+        g = PoolNode(pool, best_idx)->g;
+        for (int k = g, idx = best_idx; k >= 1; k--, idx = PoolNode(pool, idx)->parent)
+        {
+            NodeState(ctx, pool, idx, &seg[k]);
+            seg_dirs[k] = PoolNode(pool, idx)->direction;
+        }
+    }
+    FreeNodePool(pool);
+    FreeHashSet(seen);
+    return g;
+}
+
+/*
+ * OptimizeSolution — укорачивает список ходов solver для уровня level
+ * (см. начало файла). Решение заменяется, только если новое короче по
+ * шагам; иначе solver не меняется. Возвращает false, если ходы не решают
+ * уровень или не хватило памяти.
+ */
+bool OptimizeSolution(const Level *level, Solver *solver, const OptimizeOptions *options,
+                      OptimizeStats *stats)
+{
+    OptimizeStats st = {0};
+    double t_start = NowMs();
+    int window = options->window > 0 ? options->window : OPTIMIZE_WINDOW;
+    long long max_nodes = options->max_nodes > 0 ? options->max_nodes : OPTIMIZE_WINDOW_NODES;
+    double deadline = options->time_limit_ms > 0 ? t_start + options->time_limit_ms : 0;
+    st.moves_before = st.moves_after = solver->num_moves;
+
+    SearchContext ctx;
+    InitSearch(level, &ctx, options->memo, 0); // окна ищутся без эвристики
+    int nb = ctx.num_boxes;
+
+    // Толчков не больше, чем ходов; окна только укорачивают цепочку
+    size_t cap = (size_t)solver->num_moves + 1;
+    PackedState *path = (PackedState *)malloc(sizeof(PackedState) * cap);
+    PackedState *next = (PackedState *)malloc(sizeof(PackedState) * cap);
+    PackedState *seg = (PackedState *)malloc(sizeof(PackedState) * (window + 1));
+    int *dirs = (int *)malloc(sizeof(int) * cap);
+    int *next_dirs = (int *)malloc(sizeof(int) * cap);
+    int *seg_dirs = (int *)malloc(sizeof(int) * (window + 1));
+    uint64_t *keys = (uint64_t *)malloc(sizeof(uint64_t) * cap);
+    uint64_t *next_keys = (uint64_t *)malloc(sizeof(uint64_t) * cap);
+    uint8_t *dist = (uint8_t *)malloc(CELLS * CELLS);
+    uint8_t *near = (uint8_t *)malloc((size_t)(window + 1) * CELLS);
+    bool ok = false;
+    if (!path || !next || !seg || !dirs || !next_dirs || !seg_dirs || !keys || !next_keys ||
+        !dist || !near)
+        goto cleanup;
+
+    int n = ReplayPushes(&ctx, level, solver->moves, solver->num_moves, path, dirs);
+    if (n < 0) goto cleanup;
+    ok = true;
+    BuildDistances(level, dist);
+
+    // near[0] — до клеток целей: в последнем окне подходит любое решение
+    uint16_t goals[MAX_BOXES];
+    int num_goals = 0;
+    Bitboard goal_cells = ctx.masks.goals;
+    int pos;
+    while ((pos = BBPop(&goal_cells)) >= 0)
+        goals[num_goals++] = (uint16_t)pos;
+    NearTable(dist, goals, num_goals, near);
+    st.pushes_before = st.pushes_after = n;
+    for (int k = 0; k <= n; k++)
+        keys[k] = StateKey(&ctx, &path[k]);
+
+    // 1. Кратчайшие подходы; 2. петли
+    st.walk_saved = solver->num_moves - PushMoves(&ctx, path, dirs, 0, n, NULL);
+    n = CutCycles(path, dirs, keys, n, nb, &st.cycles);
+
+    // 3. Окна: после замены окно с того же толчка пробуется снова
+    bool improved = true;
+    bool stop = false;
+    while (improved && !stop)
+    {
+        improved = false;
+        for (int i = 0; i < n; )
+        {
+            if (Stopped(deadline, options->progress)) { stop = true; break; }
+            int end = i + window < n ? i + window : n;
+            int target = 0;
+            int g = Shortcut(&ctx, dist, near, path, keys, i, end, end == n, max_nodes, seg, seg_dirs,
+                             &target, &st.expanded);
+            if (g == 0) { i++; continue; }
+
+            // Цепочка с заменой: path[0..i], seg[1..g], path[target+1..n]
+            int m = n - (target - i - g);
+            memcpy(next, path, sizeof(PackedState) * (i + 1));
+            memcpy(next_dirs, dirs, sizeof(int) * (i + 1));
+            memcpy(next_keys, keys, sizeof(uint64_t) * (i + 1));
+            for (int k = 1; k <= g; k++)
+            {
+                next[i + k] = seg[k];
+                next_dirs[i + k] = seg_dirs[k];
+                next_keys[i + k] = StateKey(&ctx, &seg[k]);
+            }
+            memcpy(next + i + g + 1, path + target + 1, sizeof(PackedState) * (n - target));
+            memcpy(next_dirs + i + g + 1, dirs + target + 1, sizeof(int) * (n - target));
+            memcpy(next_keys + i + g + 1, keys + target + 1, sizeof(uint64_t) * (n - target));
+
+            // Шаги участка вместе с подходом к следующему толчку: игрок
+            // заканчивает окно в другой клетке
+            int old_moves = PushMoves(&ctx, path, dirs, i, target < n ? target + 1 : n, NULL);
+            int new_moves = PushMoves(&ctx, next, next_dirs, i, i + g < m ? i + g + 1 : m, NULL);
+            if (new_moves < 0 || new_moves > old_moves) { i++; continue; }
+
+            PackedState *tp = path; path = next; next = tp;
+            int *td = dirs; dirs = next_dirs; next_dirs = td;
+            uint64_t *tk = keys; keys = next_keys; next_keys = tk;
+            n = m;
+            st.shortcuts++;
+            improved = true;
+        }
+    }
+
+    // Итог заменяет решение, только если он короче
+    int num_moves = PushMoves(&ctx, path, dirs, 0, n, NULL);
+    if (num_moves >= 0 && num_moves < solver->num_moves)
+    {
+        Solver shorter = {0};
+        if (BuildMoves(&ctx, path, dirs, n, &shorter))
+        {
+            FreeSolver(solver);
+            *solver = shorter;
+            st.moves_after = num_moves;
+            st.pushes_after = n;
+        }
+        else
+            ok = false;
+    }
+
+    printf("[optimize] moves=%d->%d  pushes=%d->%d  cycles=%d  shortcuts=%d  expanded=%lld  ms=%.1f\n",
+           st.moves_before, st.moves_after, st.pushes_before, st.pushes_after, st.cycles,
+           st.shortcuts, st.expanded, NowMs() - t_start);
+
+cleanup:
+    free(path);
+    free(next);
+    free(seg);
+    free(dirs);
+    free(next_dirs);
+    free(seg_dirs);
+    free(keys);
+    free(next_keys);
+    free(dist);
+    free(near);
+    FreeSearch(&ctx);
+    st.ms = NowMs() - t_start;
+    if (stats) *stats = st;
+    return ok;
+}
@@ -0,0 +1,12 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "types.h"
+
+#define OPTIMIZE_WINDOW        24     // толчков в окне, внутри которого ищется путь короче
+#define OPTIMIZE_WINDOW_NODES  2000   // раскрытий на одно окно
+
+bool OptimizeSolution(const Level *level, Solver *solver, const OptimizeOptions *options,
+                      OptimizeStats *stats);
+
+#endif
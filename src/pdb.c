@@ -0,0 +1,243 @@
+/*
+ * pdb.c — базы образцов (pattern databases) уровня для эвристики
+ * решателя.
+ *
+ * Венгерская оценка считает каждый ящик отдельно и не видит, что ящики
+ * мешают друг другу: два ящика в одном коридоре, ящик, который можно
+ * толкнуть только с занятой другим ящиком стороны, и т.п. База образцов
+ * хранит точное число толчков, за которое набор из k ящиков (k = 2, 3)
+ * встаёт на любые k целей, если остальных ящиков на поле нет. Остальные
+ * ящики только мешают, поэтому это нижняя оценка толчков самих ящиков
+ * набора в полной задаче; таблица без записи — набор не решается вовсе.
+ *
+ * Таблица строится обратным поиском в ширину от целевых расстановок
+ * набора: ящики притягиваются, как в ExpandPulls (search.c). Индекс
+ * записи — ранг набора клеток (комбинаторная система счисления из
+ * StateRanks) * num_players + номер клетки игрока. Стоимость пишется во
+ * все клетки области игрока, поэтому при поиске её можно читать по
+ * нормализованной клетке полного состояния: она лежит в той же области
+ * подзадачи (без остальных ящиков область только шире).
+ */
+
+#include "pdb.h"
+#include "search.h"
+#include "bitboard.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const int PDX[4] = {0, 0, -1, 1};
+static const int PDY[4] = {-1, 1, 0, 0};
+
+/* SetRank — ранг набора клеток set (по возрастанию, живые). */
+static uint64_t SetRank(const StateRanks *r, const uint16_t *set, int k)
+{
+    uint64_t rank = 0;
+    for (int i = 0; i < k; i++)
+        rank += r->binom[r->cell_index[set[i]]][i + 1];
+    return rank;
+}
+
+/* SetUnrank — набор клеток и клетка игрока по индексу записи таблицы. */
+static void SetUnrank(const StateRanks *r, uint32_t idx, int k, uint16_t *set, int *player)
+{
+    *player = r->players[idx % (uint32_t)r->num_players];
+    uint64_t rank = idx / (uint32_t)r->num_players;
+    int hi = r->num_cells;
+    for (int i = k - 1; i >= 0; i--)
+    {
+        int lo = i;
+        while (hi - lo > 1)
+        {
+            int mid = (lo + hi) / 2;
+            if (r->binom[mid][i + 1] <= rank) lo = mid;
+            else hi = mid;
+        }
+        rank -= r->binom[lo][i + 1];
+        set[i] = r->cells[lo];
+        hi = lo;
+    }
+}
+
+/*
+ * Visit — отмечает область region при наборе set стоимостью cost (если
+ * она ещё не встречалась) и ставит её в очередь. false — нет памяти.
+ */
+static bool Visit(uint8_t *table, const StateRanks *r, const uint16_t *set, int k,
+                  const Bitboard *region, int cost, uint32_t **queue, size_t *tail, size_t *cap)
+{
+    uint64_t base = SetRank(r, set, k) * (uint64_t)r->num_players;
+    uint32_t idx = (uint32_t)(base + (uint64_t)r->player_index[BBFirst(region)]);
+    if (table[idx] != PDB_UNSOLVED) return true;
+
+    uint8_t c = (uint8_t)(cost < PDB_COST_CAP ? cost : PDB_COST_CAP);
+    Bitboard cells = *region;
+    int pos;
+    while ((pos = BBPop(&cells)) >= 0)
+        table[base + (uint64_t)r->player_index[pos]] = c;
+
+    if (*tail == *cap)
+    {
+        size_t grown = *cap ? *cap * 2 : 4096;
+        uint32_t *tmp = (uint32_t *)realloc(*queue, grown * sizeof(uint32_t));
+        if (!tmp) return false;
+        *queue = tmp;
+        *cap = grown;
+    }
+    (*queue)[(*tail)++] = idx;
+    return true;
+}
+
+/*
+ * BuildTable — таблица для наборов из k ящиков размером size: обход в
+ * ширину от всех k-наборов целей goals (игрок — в любой области) по
+ * притягиваниям. NULL — не хватило памяти.
+ */
+static uint8_t *BuildTable(const BoardMasks *m, const StateRanks *r, int k,
+                           const uint16_t *goals, int num_goals, size_t size)
+{
+    uint8_t *table = (uint8_t *)malloc(size);
+    if (!table) return NULL;
+    memset(table, PDB_UNSOLVED, size);
+
+    uint32_t *queue = NULL;
+    size_t head = 0, tail = 0, cap = 0;
+    bool ok = true;
+
+    // Старт: каждый k-набор целей, игрок в любой области свободного пола
+    int pick[PDB_MAX_SET];
+    for (int i = 0; i < k; i++) pick[i] = i;
+    for (;;)
+    {
+        uint16_t set[PDB_MAX_SET];
+        Bitboard free = m->floor;
+        for (int i = 0; i < k; i++)
+        {
+            set[i] = goals[pick[i]];
+            BBReset(&free, set[i]);
+        }
+        int start;
+        while (ok && (start = BBFirst(&free)) >= 0)
+        {
+            Bitboard region = BBFlood(&free, start, m);
+            for (int i = 0; i < CELL_WORDS; i++)
+                free.w[i] &= ~region.w[i];
+            ok = Visit(table, r, set, k, &region, 0, &queue, &tail, &cap);
+        }
+
+        // Следующее сочетание pick
+        int i = k - 1;
+        while (i >= 0 && pick[i] == num_goals - k + i) i--;
+        if (i < 0 || !ok) break;
+        pick[i]++;
+        for (int j = i + 1; j < k; j++) pick[j] = pick[j - 1] + 1;
+    }
+
+    // Притягивание ящика t в b = t - d: игрок дойдёт до b, клетка b - d
+    // свободна; от целей ящик уходит только на живые клетки
+    while (ok && head < tail)
+    {
+        uint32_t idx = queue[head++];
+        int cost = table[idx] + 1;
+        uint16_t set[PDB_MAX_SET];
+        int player;
+        SetUnrank(r, idx, k, set, &player);
+
+        Bitboard free = m->floor;
+        for (int i = 0; i < k; i++)
+            BBReset(&free, set[i]);
+        Bitboard reach = BBFlood(&free, player, m);
+
+        for (int b = 0; b < k && ok; b++)
+        {
+            for (int d = 0; d < 4 && ok; d++)
+            {
+                int px = set[b] % MAX_FIELD - 2 * PDX[d];
+                int py = set[b] / MAX_FIELD - 2 * PDY[d];
+                if (px < 0 || px >= MAX_FIELD || py < 0 || py >= MAX_FIELD) continue;
+                int bpos = set[b] - PDY[d] * MAX_FIELD - PDX[d];
+                int ppos = py * MAX_FIELD + px;
+                if (!BBTest(&reach, bpos) || !BBTest(&free, ppos) || r->cell_index[bpos] < 0)
+                    continue;
+
+                uint16_t next[PDB_MAX_SET];
+                memcpy(next, set, sizeof(uint16_t) * k);
+                next[b] = (uint16_t)bpos;
+                for (int i = 1; i < k; i++) // вставками: k не больше 3
+                    for (int j = i; j > 0 && next[j - 1] > next[j]; j--)
+                    {
+                        uint16_t tmp = next[j];
+                        next[j] = next[j - 1];
+                        next[j - 1] = tmp;
+                    }
+
+                // Область уже отмечена целиком — заливка не нужна
+                uint64_t base = SetRank(r, next, k) * (uint64_t)r->num_players;
+                if (table[base + (uint64_t)r->player_index[ppos]] != PDB_UNSOLVED) continue;
+
+                Bitboard next_free = free;
+                BBSet(&next_free, set[b]);
+                BBReset(&next_free, bpos);
+                Bitboard region = BBFlood(&next_free, ppos, m);
+                ok = Visit(table, r, next, k, &region, cost, &queue, &tail, &cap);
+            }
+        }
+    }
+
+    free(queue);
+    if (!ok)
+    {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+/*
+ * BuildPatternDB — таблицы для наборов из 2 и 3 ящиков. На уровнях
+ * меньше чем с PDB_MIN_BOXES ящиками поиск занимает миллисекунды —
+ * меньше, чем построение таблиц, и база не строится. Набор размера k
+ * строится, только если таблица влезает в PDB_MAX_BYTES, а все таблицы
+ * вместе — в max_bytes (на больших уровнях и при малом лимите памяти
+ * остаются одни пары). При нехватке памяти база просто становится
+ * меньше.
+ */
+void BuildPatternDB(const BoardMasks *m, const StateRanks *r, int nb, long long max_bytes,
+                    PatternDB *db)
+{
+    memset(db, 0, sizeof(*db));
+    db->built = true;
+    if (nb < PDB_MIN_BOXES) return;
+
+    double t_start = NowMs();
+    uint16_t goals[MAX_BOXES];
+    int num_goals = 0;
+    Bitboard g = m->goals;
+    int pos;
+    while ((pos = BBPop(&g)) >= 0)
+        goals[num_goals++] = (uint16_t)pos;
+
+    for (int k = 2; k <= PDB_MAX_SET; k++)
+    {
+        uint64_t size = PatternTableSize(r, k);
+        if (size > PDB_MAX_BYTES || db->bytes + (long long)size > max_bytes) break;
+        uint8_t *table = BuildTable(m, r, k, goals, num_goals, (size_t)size);
+        if (!table) break;
+        db->cost[k] = table;
+        db->bytes += (long long)size;
+        db->max_set = k;
+    }
+    db->build_ms = NowMs() - t_start;
+}
+
+/* FreePatternDB — освобождает таблицы базы. */
+void FreePatternDB(PatternDB *db)
+{
+    for (int k = 0; k <= PDB_MAX_SET; k++)
+    {
+        free(db->cost[k]);
+        db->cost[k] = NULL;
+    }
+    db->max_set = 0;
+    db->bytes = 0;
+    db->built = false;
+}
@@ -0,0 +1,35 @@
+#ifndef PDB_H
+#define PDB_H
+
+#include "types.h"
+
+#define PDB_MIN_BOXES   7           // на уровнях с меньшим числом ящиков база не строится
+#define PDB_MAX_BYTES   (16 << 20)  // предел памяти одной таблицы; большие наборы пропускаются
+#define PDB_UNSOLVED    255         // набор не встаёт на цели — дедлок
+#define PDB_COST_CAP    254         // большие стоимости хранятся как 254 (оценка остаётся нижней)
+#define PDB_BUDGET_SHARE 4          // база занимает не больше четверти лимита памяти поиска
+
+void BuildPatternDB(const BoardMasks *m, const StateRanks *r, int nb, long long max_bytes,
+                    PatternDB *db);
+void FreePatternDB(PatternDB *db);
+
+/* PatternTableSize — размер таблицы db->cost[k] в байтах. */
+static inline uint64_t PatternTableSize(const StateRanks *r, int k)
+{
+    return r->binom[r->num_cells][k] * (uint64_t)r->num_players;
+}
+
+/*
+ * PatternCost — стоимость набора из k ящиков (клетки по возрастанию, все
+ * живые) при игроке в клетке player из таблицы db->cost[k].
+ */
+static inline int PatternCost(const PatternDB *db, const StateRanks *r, int k,
+                              const uint16_t *set, int player)
+{
+    uint64_t rank = 0;
+    for (int i = 0; i < k; i++)
+        rank += r->binom[r->cell_index[set[i]]][i + 1];
+    return db->cost[k][rank * (uint64_t)r->num_players + (uint64_t)r->player_index[player]];
+}
+
+#endif
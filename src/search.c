@@ -0,0 +1,1274 @@
+/*
+ * search.c — общая часть всех режимов решателя (A* в solver.c, IDA* в
+ * ida.c): представление состояния, генерация толчков, эвристика и
+ * восстановление шагов игрока по найденной цепочке толчков.
+ *
+ * Поиск идёт по пространству толчков: один шаг поиска — один толчок
+ * ящика. Шаги игрока между толчками в поиске не участвуют: все клетки, до
+ * которых игрок может дойти не сдвигая ящиков, считаются одной позицией.
+ * Поэтому позиция игрока в состоянии нормализуется — вместо реальной
+ * клетки хранится канонический представитель его области достижимости
+ * (клетка с наименьшим индексом).
+ *
+ * Состояние (PackedState) — это нормализованная позиция игрока +
+ * отсортированный массив позиций всех ящиков. Позиция кодируется одним
+ * uint16_t: pos = y * MAX_FIELD + x.
+ *
+ * PackedState — только компактный формат хранения. При раскрытии
+ * состояния ящики разворачиваются в битовую карту поля (Bitboard, 7 слов
+ * по 64 бита, bitboard.h), и генерация толчков, заливка области игрока и
+ * проверка дедлоков идут пословными битовыми операциями.
+ *
+ * Эвристика h(n) — стоимость оптимального назначения ящиков на цели
+ * (венгерский алгоритм), где расстояние ящик→цель — точное число толчков
+ * по пустому уровню из таблицы PushTable. Каждый толчок сдвигает ровно
+ * один ящик на одну клетку, поэтому эвристика допустима, и оба режима
+ * находят решение с минимальным числом толчков. На больших уровнях
+ * оценку усиливает база образцов для пар и троек ящиков (pdb.c).
+ *
+ * Последовательность шагов для воспроизведения восстанавливается только в
+ * конце: между соседними толчками игрок идёт кратчайшим путём (BFS).
+ */
+
+#include "search.h"
+#include "solver.h"
+#include "analysis.h"
+#include "bitboard.h"
+#include "nodes.h"
+#include "pdb.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Векторы смещений для четырёх направлений: вверх, вниз, влево, вправо. */
+static const int SDX[4] = {0, 0, -1, 1};
+static const int SDY[4] = {-1, 1, 0, 0};
+
+/* ---------- Вспомогательные функции для работы с ящиками ---------- */
+
+/*
+ * SortBoxes — сортировка массива позиций ящиков вставками.
+ * Порядок позиций не важен для игры, но важен для сравнения состояний:
+ * одни и те же ящики всегда дают одинаковую PackedState независимо от
+ * порядка их толчков.
+ */
+static void SortBoxes(uint16_t *boxes, int n)
+{
+    for (int i = 1; i < n; i++)
+    {
+        uint16_t key = boxes[i];
+        int j = i - 1;
+        while (j >= 0 && boxes[j] > key)
+        {
+            boxes[j + 1] = boxes[j];
+            j--;
+        }
+        boxes[j + 1] = key;
+    }
+}
+
+/*
+ * MoveBoxSorted — переставляет ящик с индексом b в позицию pos, сохраняя
+ * массив отсортированным. Остальные ящики уже упорядочены, поэтому
+ * достаточно сдвинуть один элемент — O(n) вместо полной сортировки.
+ */
+static void MoveBoxSorted(uint16_t *boxes, int n, int b, uint16_t pos)
+{
+    while (b > 0 && boxes[b - 1] > pos)
+    {
+        boxes[b] = boxes[b - 1];
+        b--;
+    }
+    while (b < n - 1 && boxes[b + 1] < pos)
+    {
+        boxes[b] = boxes[b + 1];
+        b++;
+    }
+    boxes[b] = pos;
+}
+
+/* ---------- Ключи Zobrist ---------- */
+
+/*
+ * Ключ состояния — XOR случайных 64-битных чисел: по одному на каждую
+ * клетку с ящиком и одно на клетку игрока. Порядок ящиков на ключ не
+ * влияет, а толчок меняет ключ четырьмя XOR (ящик ушёл/пришёл, старая и
+ * новая нормализованная позиция игрока) без пересчёта всего состояния.
+ * Ключ хранится в узле и в хеш-таблице, поэтому при росте таблицы
+ * ничего не перехешируется.
+ */
+
+/* SplitMix64 — генератор чисел для таблиц Zobrist (фиксированное зерно). */
+static uint64_t SplitMix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void InitZobrist(ZobristKeys *zk)
+{
+    uint64_t seed = 0x5ab0ba11ULL;
+    for (int i = 0; i < MAX_FIELD * MAX_FIELD; i++)
+    {
+        zk->box[i] = SplitMix64(&seed);
+        zk->player[i] = SplitMix64(&seed);
+    }
+}
+
+/* ZobristKey — полный ключ состояния (нужен только для корня и целей). */
+static uint64_t ZobristKey(const ZobristKeys *zk, const PackedState *ps, int nb)
+{
+    uint64_t key = zk->player[ps->player];
+    for (int i = 0; i < nb; i++)
+        key ^= zk->box[ps->boxes[i]];
+    return key;
+}
+
+/* ---------- Точные ключи (ранги) ---------- */
+
+/*
+ * Ящики стоят только на живых клетках пола, поэтому набор из nb ящиков —
+ * это nb-сочетание из num_cells клеток. Номер клетки ящика c_i (по
+ * возрастанию позиции, как и отсортированные ящики) даёт ранг набора в
+ * комбинаторной системе счисления: sum C(c_i, i + 1) — взаимно
+ * однозначно с числами 0 .. C(num_cells, nb) - 1. Ключ состояния —
+ * ранг * num_players + номер клетки игрока.
+ *
+ * Если все такие ключи умещаются в 64 бита (обычно так и есть: даже 8
+ * ящиков на 256 клетках дают меньше 2^57 ключей), ключ сам задаёт
+ * состояние: хеш-таблица сравнивает только ключи, а пул не хранит
+ * состояний и восстанавливает их по ключу. Иначе используются ключи
+ * Zobrist и хранимые состояния.
+ */
+
+/* InitRanks — нумерация клеток и таблица сочетаний; ranks->exact — влезет ли ключ. */
+static void InitRanks(const BoardMasks *m, int nb, StateRanks *r)
+{
+    r->num_cells = 0;
+    r->num_players = 0;
+    for (int pos = 0; pos < MAX_FIELD * MAX_FIELD; pos++)
+    {
+        r->cell_index[pos] = -1;
+        r->player_index[pos] = -1;
+        if (BBTest(&m->box_ok, pos))
+        {
+            r->cells[r->num_cells] = (unsigned short)pos;
+            r->cell_index[pos] = (short)r->num_cells++;
+        }
+        if (BBTest(&m->floor, pos))
+        {
+            r->players[r->num_players] = (unsigned short)pos;
+            r->player_index[pos] = (short)r->num_players++;
+        }
+    }
+
+    // Треугольник Паскаля с насыщением: UINT64_MAX — «не влезло»
+    for (int n = 0; n <= r->num_cells; n++)
+    {
+        r->binom[n][0] = 1;
+        for (int k = 1; k <= nb; k++)
+        {
+            uint64_t v = 0;
+            if (n > 0 && __builtin_add_overflow(r->binom[n - 1][k - 1], r->binom[n - 1][k], &v))
+                v = UINT64_MAX;
+            r->binom[n][k] = v;
+        }
+    }
+
+    // Ключи 0 .. total - 1; UINT64_MAX остаётся свободным (HashSet
+    // хранит под ним нулевой ключ)
+    uint64_t total;
+    r->fits = r->binom[r->num_cells][nb] != UINT64_MAX &&
+               !__builtin_mul_overflow(r->binom[r->num_cells][nb], (uint64_t)r->num_players, &total);
+}
+
+/* RankKey — точный ключ состояния (ящики отсортированы и стоят на живых клетках). */
+static uint64_t RankKey(const StateRanks *r, const PackedState *ps, int nb)
+{
+    uint64_t rank = 0;
+    for (int i = 0; i < nb; i++)
+        rank += r->binom[r->cell_index[ps->boxes[i]]][i + 1];
+    return rank * (uint64_t)r->num_players + (uint64_t)r->player_index[ps->player];
+}
+
+/*
+ * UnrankKey — обратное к RankKey: ящики восстанавливаются от старшего,
+ * для каждого двоичным поиском берётся наибольший номер клетки c с
+ * C(c, i + 1) не больше остатка ранга.
+ */
+static void UnrankKey(const StateRanks *r, uint64_t key, int nb, PackedState *out)
+{
+    out->player = r->players[key % (uint64_t)r->num_players];
+    uint64_t rank = key / (uint64_t)r->num_players;
+    int hi = r->num_cells; // номера ящиков строго убывают
+    for (int i = nb - 1; i >= 0; i--)
+    {
+        int lo = i; // C(i, i + 1) = 0 — всегда подходит
+        while (hi - lo > 1)
+        {
+            int mid = (lo + hi) / 2;
+            if (r->binom[mid][i + 1] <= rank) lo = mid;
+            else hi = mid;
+        }
+        rank -= r->binom[lo][i + 1];
+        out->boxes[i] = r->cells[lo];
+        hi = lo;
+    }
+}
+
+/* StateKey — полный ключ состояния: ранг или ключ Zobrist. */
+uint64_t StateKey(const SearchContext *ctx, const PackedState *ps)
+{
+    if (ctx->ranks.exact) return RankKey(&ctx->ranks, ps, ctx->num_boxes);
+    return ZobristKey(&ctx->zk, ps, ctx->num_boxes);
+}
+
+/*
+ * NodeState — состояние узла idx пула: копия из pool->states или, при
+ * точных ключах, восстановление по ключу узла.
+ */
+void NodeState(const SearchContext *ctx, const NodePool *pool, int idx, PackedState *out)
+{
+    if (pool->states)
+        *out = *PoolState(pool, idx);
+    else
+        UnrankKey(&ctx->ranks, PoolNode(pool, idx)->key, ctx->num_boxes, out);
+}
+
+/* ---------- Эвристика ---------- */
+
+/*
+ * AssignCost — стоимость оптимального назначения ящиков на цели: каждому
+ * ящику своя цель, суммарное число толчков по таблице pt минимально
+ * (задача о назначениях, венгерский алгоритм за O(n^3)).
+ *
+ * Если row, col не NULL, в них пишутся итоговые потенциалы u (ящики) и
+ * v (цели): u[i] + v[j] не больше расстояния от ящика i до цели j, а
+ * сумма всех потенциалов равна стоимости. По ним StateHeuristic без
+ * повторного назначения оценивает часть ящиков.
+ *
+ * Возвращает H_INF, если назначения без недостижимых пар не существует.
+ */
+static int AssignCost(const PushTable *pt, const uint16_t *boxes, int n, int *row, int *col)
+{
+    // Неразрешимая пара получает штраф, заведомо больший любого решения
+    enum { BIG = 1 << 20 };
+    int a[MAX_BOXES + 1][MAX_BOXES + 1];
+    for (int i = 1; i <= n; i++)
+    {
+        int any = 0;
+        for (int j = 1; j <= n; j++)
+        {
+            int d = pt->dist[j - 1][boxes[i - 1]];
+            a[i][j] = (d == PUSH_DIST_INF) ? BIG : d;
+            if (d != PUSH_DIST_INF) any = 1;
+        }
+        if (!any) return H_INF; // ящик не доедет ни до одной цели
+    }
+
+    // Венгерский алгоритм с потенциалами u, v; p[j] — строка, назначенная столбцу j
+    int u[MAX_BOXES + 1] = {0}, v[MAX_BOXES + 1] = {0};
+    int p[MAX_BOXES + 1] = {0}, way[MAX_BOXES + 1] = {0};
+    for (int i = 1; i <= n; i++)
+    {
+        int minv[MAX_BOXES + 1];
+        bool used[MAX_BOXES + 1];
+        for (int j = 0; j <= n; j++) { minv[j] = INT_MAX; used[j] = false; }
+        p[0] = i;
+        int j0 = 0;
+        do
+        {
+            used[j0] = true;
+            int i0 = p[j0], delta = INT_MAX, j1 = 0;
+            for (int j = 1; j <= n; j++)
+            {
+                if (used[j]) continue;
+                int cur = a[i0][j] - u[i0] - v[j];
+                if (cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+                if (minv[j] < delta) { delta = minv[j]; j1 = j; }
+            }
+            for (int j = 0; j <= n; j++)
+            {
+                if (used[j]) { u[p[j]] += delta; v[j] -= delta; }
+                else minv[j] -= delta;
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+        do
+        {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    int h = -v[0]; // стоимость оптимального назначения
+    if (h >= BIG) return H_INF;
+    if (row && col)
+    {
+        memcpy(row, u + 1, sizeof(int) * n);
+        memcpy(col, v + 1, sizeof(int) * n);
+    }
+    return h;
+}
+
+/*
+ * Heuristic — нижняя оценка оставшейся стоимости пути (h(n)) по одним
+ * ящикам: стоимость оптимального назначения ящиков на цели (AssignCost).
+ * В отличие от суммы расстояний до ближайшей цели, два ящика не могут
+ * «претендовать» на одну цель, а расстояния учитывают стены. Эвристика
+ * допустима: в любом решении ящики занимают разные цели, и каждый толчок
+ * сдвигает один ящик на клетку.
+ *
+ * Возвращает H_INF, если назначения без недостижимых пар не существует —
+ * такое состояние нерешаемо и отсекается.
+ */
+int Heuristic(const PushTable *pt, const uint16_t *boxes, int n)
+{
+    return AssignCost(pt, boxes, n, NULL, NULL);
+}
+
+/*
+ * StateHeuristic — оценка h состояния для поиска: назначение ящиков
+ * (Heuristic), усиленное базой образцов уровня, если она построена.
+ *
+ * Для каждой пары и тройки ящиков S толчки ящиков S и остальных не
+ * пересекаются, поэтому h не меньше cost(S) из базы плюс нижняя оценка
+ * назначения остальных ящиков на любые цели. Последняя берётся из
+ * потенциалов уже решённого назначения (двойственная задача): u
+ * остальных ящиков, все v и по -max(v) за каждый ящик S, занимающий
+ * какую-то цель, — без повторного венгерского алгоритма. Итог — максимум
+ * по всем наборам; набор, который нельзя поставить на цели даже без
+ * остальных ящиков, даёт H_INF.
+ *
+ * Оценка допустима, но не обязательно монотонна; режимы поиска
+ * переоткрывают состояние, найденное позже с меньшим g, поэтому
+ * оптимальность решения сохраняется.
+ */
+int StateHeuristic(const SearchContext *ctx, const PackedState *ps)
+{
+    int n = ctx->num_boxes;
+    int u[MAX_BOXES], v[MAX_BOXES];
+    int h = AssignCost(&ctx->pt, ps->boxes, n, u, v);
+    if (h == H_INF || ctx->pdb.max_set < 2) return h;
+
+    // base - u[S] - k * vmax — оценка назначения ящиков вне набора S
+    int base = 0, vmax = INT_MIN;
+    for (int i = 0; i < n; i++)
+    {
+        base += u[i] + v[i];
+        if (v[i] > vmax) vmax = v[i];
+    }
+
+    const PatternDB *db = &ctx->pdb;
+    const StateRanks *r = &ctx->ranks;
+    uint16_t set[PDB_MAX_SET];
+    for (int i = 0; i < n; i++)
+    {
+        set[0] = ps->boxes[i];
+        for (int j = i + 1; j < n; j++)
+        {
+            set[1] = ps->boxes[j];
+            int cost = PatternCost(db, r, 2, set, ps->player);
+            if (cost == PDB_UNSOLVED) return H_INF;
+            int bound = cost + base - u[i] - u[j] - 2 * vmax;
+            if (bound > h) h = bound;
+            if (db->max_set < 3) continue;
+            for (int l = j + 1; l < n; l++)
+            {
+                set[2] = ps->boxes[l];
+                cost = PatternCost(db, r, 3, set, ps->player);
+                if (cost == PDB_UNSOLVED) return H_INF;
+                bound = cost + base - u[i] - u[j] - u[l] - 3 * vmax;
+                if (bound > h) h = bound;
+            }
+        }
+    }
+    return h;
+}
+
+/* ---------- Обнаружение дедлоков ---------- */
+
+/*
+ * IsDeadState — проверяет, не создал ли толчок тупиковую расстановку
+ * (дедлок), из которой решение уже невозможно.
+ *
+ * Одиночные мёртвые клетки (углы, участки вдоль стен без целей) сюда не
+ * доходят: их исключает маска box_ok при генерации толчков. Здесь
+ * остаётся дедлок, в котором участвуют другие ящики:
+ *
+ * Блокировка 2×2 (freeze deadlock):
+ *    Четыре клетки в квадрате 2×2 заняты стенами или ящиками, и хотя бы
+ *    один ящик в этом квадрате не стоит на цели. Ни один ящик в таком
+ *    квадрате никогда не сдвинется.
+ *
+ * Проверка идёт по всему полю сразу: бит p в full — квадрат с левым
+ * верхним углом p целиком занят, бит p в loose — в этом квадрате есть
+ * ящик вне цели. Дедлок — пересечение этих карт.
+ */
+static int IsDeadState(const BoardMasks *m, const Bitboard *boxes)
+{
+    Bitboard blocked, loose;
+    for (int i = 0; i < CELL_WORDS; i++)
+    {
+        blocked.w[i] = ~m->floor.w[i] | boxes->w[i];  // стена или ящик
+        loose.w[i] = boxes->w[i] & ~m->goals.w[i];    // ящик вне цели
+    }
+
+    Bitboard b1 = BBShr(&blocked, 1), b20 = BBShr(&blocked, MAX_FIELD), b21 = BBShr(&blocked, MAX_FIELD + 1);
+    Bitboard l1 = BBShr(&loose, 1), l20 = BBShr(&loose, MAX_FIELD), l21 = BBShr(&loose, MAX_FIELD + 1);
+
+    uint64_t dead = 0;
+    for (int i = 0; i < CELL_WORDS; i++)
+    {
+        uint64_t full = blocked.w[i] & b1.w[i] & b20.w[i] & b21.w[i] & m->not_last_col.w[i];
+        uint64_t any_loose = loose.w[i] | l1.w[i] | l20.w[i] | l21.w[i];
+        dead |= full & any_loose;
+    }
+    return dead != 0;
+}
+
+/*
+ * FrozenBox — ящик на pos больше никогда не сдвинется (freeze deadlock).
+ *
+ * Ящик заблокирован по оси (вертикальной или горизонтальной), если
+ * хотя бы с одной её стороны стена, если обе клетки на оси мёртвые
+ * (толкать вдоль неё бесполезно), или если с одной из сторон стоит ящик,
+ * который сам заморожен. Ящик заморожен, если заблокирован по обеим
+ * осям. Проверка соседей идёт рекурсивно по цепочке ящиков; ящики,
+ * которые сейчас проверяются выше по цепочке (on_stack), считаются
+ * стенами — так взаимно блокирующие ящики не зацикливают проверку.
+ *
+ * В *off_goal отмечается, что в замороженной группе есть ящик вне цели.
+ */
+static bool FrozenBox(const SearchContext *ctx, const Bitboard *boxes, Bitboard *on_stack,
+                      int pos, bool *off_goal)
+{
+    const BoardMasks *m = &ctx->masks;
+    BBSet(on_stack, pos);
+
+    bool frozen = true;
+    for (int axis = 0; axis < 2 && frozen; axis++)
+    {
+        // axis 0 — вертикаль (направления 0, 1), axis 1 — горизонталь (2, 3)
+        int a = pos + SDY[2 * axis] * MAX_FIELD + SDX[2 * axis];
+        int b = pos + SDY[2 * axis + 1] * MAX_FIELD + SDX[2 * axis + 1];
+        bool wall_a = !BBTest(&m->floor, a) || BBTest(on_stack, a);
+        bool wall_b = !BBTest(&m->floor, b) || BBTest(on_stack, b);
+
+        bool blocked = wall_a || wall_b ||
+                       (IsDeadSquare(&ctx->pt, a) && IsDeadSquare(&ctx->pt, b)) ||
+                       (BBTest(boxes, a) && FrozenBox(ctx, boxes, on_stack, a, off_goal)) ||
+                       (BBTest(boxes, b) && FrozenBox(ctx, boxes, on_stack, b, off_goal));
+        if (!blocked) frozen = false;
+    }
+
+    BBReset(on_stack, pos);
+    if (frozen && !BBTest(&m->goals, pos)) *off_goal = true;
+    return frozen;
+}
+
+/*
+ * IsFreezeDeadlock — толчок поставил ящик pos так, что он заморожен
+ * вместе с цепочкой соседей, и хотя бы один из них не на цели. Ловит
+ * то, что не видит IsDeadState: ящики, прижатые к стене другими ящиками,
+ * и цепочки вдоль обеих осей, а не только полный квадрат 2×2.
+ */
+static bool IsFreezeDeadlock(const SearchContext *ctx, const Bitboard *boxes, int pos)
+{
+    Bitboard on_stack;
+    BBClear(&on_stack);
+    bool off_goal = false;
+    return FrozenBox(ctx, boxes, &on_stack, pos, &off_goal) && off_goal;
+}
+
+/* ---------- PI-корраль ---------- */
+
+/*
+ * Корраль — связная область свободного пола, куда игрок не может попасть,
+ * отгороженная ящиками (барьером). PI-корраль — корраль, у которого
+ * каждый ящик барьера игрок может толкнуть (P), и любой такой толчок
+ * ведёт внутрь корраля (I). Если в коррале или на его барьере есть
+ * нерешённое (ящик вне цели или пустая цель внутри), решение обязательно
+ * толкнёт ящик барьера внутрь, а толчки в других местах этого не
+ * приблизят — раскрывать достаточно только толчки ящиков барьера.
+ *
+ * FindPICorral проверяет каждую недостижимую область отдельно. Если
+ * PI-корралей несколько, выбирается тот, что оставляет меньше толчков.
+ * pushable[d] — все допустимые толчки в сторону d; в *only записывается
+ * барьер выбранного корраля. Возвращает false, если PI-корраля нет.
+ */
+static bool FindPICorral(const BoardMasks *m, const Bitboard *boxes, const Bitboard *reach,
+                         const Bitboard pushable[4], Bitboard *only)
+{
+    Bitboard unreach;
+    for (int i = 0; i < CELL_WORDS; i++)
+        unreach.w[i] = m->floor.w[i] & ~boxes->w[i] & ~reach->w[i];
+    if (BBIsZero(&unreach)) return false;
+
+    // Ящик, который не толкается совсем или толкается в область игрока,
+    // не может стоять в барьере PI-корраля: области рядом с такими
+    // ящиками отбрасываются одной заливкой, без разбора по одной
+    Bitboard into = {{0}}, bad;
+    for (int d = 0; d < 4; d++)
+    {
+        Bitboard inward = BBStep(&unreach, d ^ 1, m);
+        for (int i = 0; i < CELL_WORDS; i++)
+            into.w[i] |= pushable[d].w[i] & inward.w[i];
+    }
+    if (BBIsZero(&into)) return false;
+    for (int i = 0; i < CELL_WORDS; i++)
+        bad.w[i] = boxes->w[i] & ~into.w[i];
+    for (int d = 0; d < 4; d++)
+    {
+        Bitboard outward = BBStep(reach, d ^ 1, m);
+        for (int i = 0; i < CELL_WORDS; i++)
+            bad.w[i] |= pushable[d].w[i] & outward.w[i];
+    }
+    Bitboard near_bad = {{0}};
+    for (int d = 0; d < 4; d++)
+    {
+        Bitboard near = BBStep(&bad, d, m);
+        for (int i = 0; i < CELL_WORDS; i++)
+            near_bad.w[i] |= near.w[i] & unreach.w[i];
+    }
+    Bitboard poisoned = BBFloodFrom(&unreach, &near_bad, m);
+    for (int i = 0; i < CELL_WORDS; i++)
+        unreach.w[i] &= ~poisoned.w[i];
+
+    bool found = false;
+    int best = 0;
+    int start;
+    while ((start = BBFirst(&unreach)) >= 0)
+    {
+        Bitboard area = BBFlood(&unreach, start, m);
+        for (int i = 0; i < CELL_WORDS; i++)
+            unreach.w[i] &= ~area.w[i];
+
+        // Барьер — ящики, соседние с областью
+        Bitboard barrier;
+        BBClear(&barrier);
+        for (int d = 0; d < 4; d++)
+        {
+            Bitboard near = BBStep(&area, d, m);
+            for (int i = 0; i < CELL_WORDS; i++)
+                barrier.w[i] |= near.w[i] & boxes->w[i];
+        }
+
+        // I: толчки ящиков барьера только внутрь; P: каждый ящик толкается
+        bool ok = true;
+        Bitboard movable;
+        BBClear(&movable);
+        int pushes = 0;
+        for (int d = 0; d < 4 && ok; d++)
+        {
+            Bitboard inward = BBStep(&area, d ^ 1, m); // ящики, чей толчок в d ведёт в area
+            for (int i = 0; i < CELL_WORDS; i++)
+            {
+                uint64_t mine = pushable[d].w[i] & barrier.w[i];
+                if (mine & ~inward.w[i]) ok = false;
+                movable.w[i] |= mine;
+                pushes += __builtin_popcountll(mine);
+            }
+        }
+        if (!ok || !BBEqual(&movable, &barrier)) continue;
+
+        // Корраль, где всё уже на целях, решения не требует
+        bool unsolved = false;
+        for (int i = 0; i < CELL_WORDS; i++)
+            if ((barrier.w[i] & ~m->goals.w[i]) || (area.w[i] & m->goals.w[i])) unsolved = true;
+        if (!unsolved) continue;
+
+        if (!found || pushes < best)
+        {
+            found = true;
+            best = pushes;
+            *only = barrier;
+        }
+    }
+    return found;
+}
+
+/* ---------- Битовые карты уровня ---------- */
+
+/*
+ * BuildMasks — битовые маски уровня для горячего цикла: пол, цели,
+ * клетки, куда можно толкать ящик (пол без мёртвых клеток), и маски
+ * столбцов, отсекающие перенос через край строки при сдвиге на 1.
+ */
+static void BuildMasks(const Level *level, const PushTable *pt, BoardMasks *m)
+{
+    BBClear(&m->floor);
+    BBClear(&m->goals);
+    BBClear(&m->not_first_col);
+    BBClear(&m->not_last_col);
+
+    for (int y = 0; y < level->height; y++)
+        for (int x = 0; x < level->width; x++)
+            if (level->cells[y][x] != CELL_WALL) BBSet(&m->floor, y * MAX_FIELD + x);
+    for (int i = 0; i < level->num_boxes; i++)
+        BBSet(&m->goals, level->goals[i].y * MAX_FIELD + level->goals[i].x);
+    for (int pos = 0; pos < MAX_FIELD * MAX_FIELD; pos++)
+    {
+        if (pos % MAX_FIELD != 0) BBSet(&m->not_first_col, pos);
+        if (pos % MAX_FIELD != MAX_FIELD - 1) BBSet(&m->not_last_col, pos);
+    }
+    for (int i = 0; i < CELL_WORDS; i++)
+        m->box_ok.w[i] = m->floor.w[i] & ~pt->dead.w[i];
+}
+
+/* ToBitboard — битовая карта ящиков упакованного состояния. */
+static Bitboard ToBitboard(const uint16_t *boxes, int nb)
+{
+    Bitboard bb;
+    BBClear(&bb);
+    for (int i = 0; i < nb; i++)
+        BBSet(&bb, boxes[i]);
+    return bb;
+}
+
+/*
+ * PlayerReach — область, куда игрок может дойти из клетки start, не
+ * сдвигая ящиков: заливка BBFlood по полу без ящиков.
+ */
+static Bitboard PlayerReach(const BoardMasks *m, const Bitboard *boxes, int start)
+{
+    Bitboard free;
+    for (int i = 0; i < CELL_WORDS; i++)
+        free.w[i] = m->floor.w[i] & ~boxes->w[i];
+    return BBFlood(&free, start, m);
+}
+
+/* ---------- Подготовка и раскрытие состояний ---------- */
+
+/*
+ * LevelShapeKey — отпечаток того, от чего зависит анализ уровня: размеры,
+ * стены и цели (FNV-1a). Ящики и игрок в него не входят.
+ */
+static uint64_t LevelShapeKey(const Level *level)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = (hash ^ (uint64_t)level->width) * 0x100000001b3ULL;
+    hash = (hash ^ (uint64_t)level->height) * 0x100000001b3ULL;
+    for (int y = 0; y < level->height; y++)
+        for (int x = 0; x < level->width; x++)
+            hash = (hash ^ (uint64_t)(level->cells[y][x] == CELL_WALL)) * 0x100000001b3ULL;
+    for (int i = 0; i < level->num_boxes; i++)
+        hash = (hash ^ (uint64_t)(level->goals[i].y * MAX_FIELD + level->goals[i].x)) * 0x100000001b3ULL;
+    return hash;
+}
+
+/*
+ * CurrentState — упакованное состояние уровня: ящики отсортированы,
+ * игрок нормализован (наименьшая клетка его области).
+ */
+PackedState CurrentState(const SearchContext *ctx, const Level *level)
+{
+    PackedState ps;
+    int nb = level->num_boxes;
+    for (int i = 0; i < nb; i++)
+        ps.boxes[i] = (uint16_t)(level->boxes[i].y * MAX_FIELD + level->boxes[i].x);
+    SortBoxes(ps.boxes, nb);
+    Bitboard boxes = ToBitboard(ps.boxes, nb);
+    Bitboard reach = PlayerReach(&ctx->masks, &boxes, level->player.y * MAX_FIELD + level->player.x);
+    ps.player = (uint16_t)BBFirst(&reach);
+    return ps;
+}
+
+/* InitRoot — корень поиска: текущие ящики и игрок уровня, его ключ. */
+static void InitRoot(const Level *level, SearchContext *ctx, SolverMemo *memo)
+{
+    int nb = level->num_boxes;
+    ctx->level = level;
+    ctx->num_boxes = nb;
+    ctx->memo = memo;
+    ctx->root = CurrentState(ctx, level);
+
+    // Ящик на мёртвой клетке рангом не описать (такой корень всё равно
+    // отсекается эвристикой)
+    ctx->ranks.exact = ctx->ranks.fits;
+    for (int i = 0; i < nb; i++)
+        if (ctx->ranks.cell_index[ctx->root.boxes[i]] < 0) ctx->ranks.exact = false;
+    ctx->root_key = StateKey(ctx, &ctx->root);
+}
+
+/*
+ * InitSearch — предрасчёт по уровню, общий для всех режимов: таблица
+ * расстояний в толчках и мёртвых клеток, битовые маски, ключи Zobrist,
+ * нумерация для точных ключей, база образцов (pdb.c) и корневое
+ * состояние — текущие ящики и игрок уровня. Если memo уже хранит анализ
+ * уровня с теми же стенами и целями, он копируется вместо построения;
+ * иначе memo заполняется заново (старое решение в нём сбрасывается) и
+ * забирает базу образцов себе. Парный вызов — FreeSearch.
+ *
+ * pdb_bytes — предел памяти базы (PatternBudget); 0 — режиму база не
+ * нужна и не строится. База из memo, построенная при большем пределе,
+ * урезается только в копии ctx: лишние таблицы остаются у memo.
+ */
+void InitSearch(const Level *level, SearchContext *ctx, SolverMemo *memo, long long pdb_bytes)
+{
+    int nb = level->num_boxes;
+    uint64_t shape = LevelShapeKey(level);
+    if (memo && memo->valid && memo->level_key == shape)
+    {
+        *ctx = memo->ctx;
+        ctx->pdb.build_ms = 0;
+        if (!ctx->pdb.built && pdb_bytes > 0) // прошлым режимам база была не нужна
+        {
+            BuildPatternDB(&ctx->masks, &ctx->ranks, nb, pdb_bytes, &ctx->pdb);
+            memo->ctx.pdb = ctx->pdb;
+        }
+        while (ctx->pdb.max_set >= 2 && ctx->pdb.bytes > pdb_bytes)
+        {
+            ctx->pdb.bytes -= (long long)PatternTableSize(&ctx->ranks, ctx->pdb.max_set);
+            ctx->pdb.cost[ctx->pdb.max_set--] = NULL;
+        }
+        if (ctx->pdb.max_set < 2) ctx->pdb.max_set = 0;
+    }
+    else
+    {
+        BuildPushTable(level, &ctx->pt);
+        BuildMasks(level, &ctx->pt, &ctx->masks);
+        InitZobrist(&ctx->zk);
+        InitRanks(&ctx->masks, nb, &ctx->ranks);
+        if (pdb_bytes > 0)
+            BuildPatternDB(&ctx->masks, &ctx->ranks, nb, pdb_bytes, &ctx->pdb);
+        else
+            memset(&ctx->pdb, 0, sizeof(ctx->pdb));
+        if (memo)
+        {
+            FreeSolverMemo(memo);
+            memo->ctx = *ctx;
+            memo->level_key = shape;
+            memo->valid = true;
+        }
+    }
+    InitRoot(level, ctx, memo);
+}
+
+/*
+ * InitPullSearch — то же, что InitSearch, но без базы образцов и memo:
+ * обходу притягиваниями от целей (генератор уровней, level.c) эвристика не
+ * нужна, а строить базу дольше самого обхода. Парный вызов — FreeSearch.
+ */
+void InitPullSearch(const Level *level, SearchContext *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    BuildPushTable(level, &ctx->pt);
+    BuildMasks(level, &ctx->pt, &ctx->masks);
+    InitZobrist(&ctx->zk);
+    InitRanks(&ctx->masks, level->num_boxes, &ctx->ranks);
+    InitRoot(level, ctx, NULL);
+}
+
+/* FreeSearch — освобождает базу образцов ctx, если она не принадлежит memo. */
+void FreeSearch(SearchContext *ctx)
+{
+    if (!ctx->memo) FreePatternDB(&ctx->pdb);
+}
+
+/*
+ * SolveFromMemo — если текущее состояние уровня лежит на цепочке толчков
+ * последнего решения из memo, ходы строятся по её остатку без поиска.
+ * need_optimal — годится только оптимальная цепочка (её остаток тоже
+ * оптимален). Возвращает true, если решение записано в solver; число
+ * толчков остатка — в *pushes.
+ */
+bool SolveFromMemo(const Level *level, SolverMemo *memo, bool need_optimal, Solver *solver,
+                   int *pushes)
+{
+    if (!memo->valid || !memo->path || memo->level_key != LevelShapeKey(level))
+        return false;
+    if (need_optimal && !memo->optimal)
+        return false;
+
+    SearchContext *ctx = &memo->ctx;
+    ctx->level = level;
+    ctx->num_boxes = level->num_boxes;
+    ctx->memo = NULL; // остаток цепочки не должен затирать её саму
+    PackedState cur = CurrentState(ctx, level);
+    for (int k = 0; k <= memo->num_pushes; k++)
+    {
+        const PackedState *ps = &memo->path[k];
+        if (ps->player != cur.player ||
+            memcmp(ps->boxes, cur.boxes, sizeof(uint16_t) * level->num_boxes) != 0)
+            continue;
+        *pushes = memo->num_pushes - k;
+        return BuildMoves(ctx, ps, memo->dirs + k, memo->num_pushes - k, solver);
+    }
+    return false;
+}
+
+/*
+ * RememberPath — копирует цепочку толчков решения в memo (при нехватке
+ * памяти прежняя цепочка просто сбрасывается). Оптимальность цепочки
+ * отмечает SolveLevelEx, когда поиск закончен.
+ */
+static void RememberPath(SolverMemo *memo, const PackedState *path, const int *dirs, int num_pushes)
+{
+    free(memo->path);
+    free(memo->dirs);
+    memo->path = (PackedState *)malloc(sizeof(PackedState) * (num_pushes + 1));
+    memo->dirs = (int *)malloc(sizeof(int) * (num_pushes + 1));
+    memo->num_pushes = 0;
+    memo->optimal = false;
+    if (!memo->path || !memo->dirs)
+    {
+        free(memo->path);
+        free(memo->dirs);
+        memo->path = NULL;
+        memo->dirs = NULL;
+        return;
+    }
+    memcpy(memo->path, path, sizeof(PackedState) * (num_pushes + 1));
+    memcpy(memo->dirs, dirs, sizeof(int) * (num_pushes + 1));
+    memo->num_pushes = num_pushes;
+}
+
+/* IsGoalState — все ящики стоят на целях. */
+bool IsGoalState(const SearchContext *ctx, const PackedState *ps)
+{
+    Bitboard boxes = ToBitboard(ps->boxes, ctx->num_boxes);
+    return BBEqual(&boxes, &ctx->masks.goals);
+}
+
+/*
+ * ExpandState — все толчки из состояния cur (ключ cur_key), не ведущие в
+ * дедлок. Дочерние состояния с ключами и направлениями толчков
+ * записываются в out (не больше MAX_CHILDREN), возвращается их число.
+ * Повторы и эвристику проверяет вызывающий режим поиска; отсечённые
+ * толчки считаются в stats.
+ *
+ * Область игрока заливается один раз; затем для каждого из 4 направлений
+ * d одной серией битовых операций находятся все ящики, которые можно
+ * толкнуть: игрок стоит с обратной стороны, клетка за ящиком — пол без
+ * ящика и не мёртвая. Если есть PI-корраль, остаются только толчки ящиков
+ * его барьера.
+ */
+int ExpandState(const SearchContext *ctx, const PackedState *cur, uint64_t cur_key,
+                SearchChild *out, PruneStats *stats)
+{
+    const BoardMasks *masks = &ctx->masks;
+    const ZobristKeys *zk = &ctx->zk;
+    int nb = ctx->num_boxes;
+    int count = 0;
+
+    Bitboard boxes = ToBitboard(cur->boxes, nb);
+
+    // Область, куда игрок может дойти без толчков
+    Bitboard reach = PlayerReach(masks, &boxes, cur->player);
+
+    // Клетки, куда можно поставить ящик: не мёртвый пол без ящика
+    Bitboard target;
+    for (int i = 0; i < CELL_WORDS; i++)
+        target.w[i] = masks->box_ok.w[i] & ~boxes.w[i];
+
+    // Ящик b толкается в сторону d, если игрок дойдёт до b - d,
+    // а клетка b + d свободна: сдвигаем карты навстречу ящикам
+    Bitboard pushable[4];
+    int total = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        Bitboard behind = BBStep(&reach, d, masks);
+        Bitboard ahead  = BBStep(&target, d ^ 1, masks);
+        for (int i = 0; i < CELL_WORDS; i++)
+            pushable[d].w[i] = boxes.w[i] & behind.w[i] & ahead.w[i];
+        total += BBCount(&pushable[d]);
+    }
+
+    Bitboard only;
+    if (FindPICorral(masks, &boxes, &reach, pushable, &only))
+    {
+        int kept = 0;
+        for (int d = 0; d < 4; d++)
+        {
+            for (int i = 0; i < CELL_WORDS; i++)
+                pushable[d].w[i] &= only.w[i];
+            kept += BBCount(&pushable[d]);
+        }
+        stats->corral += total - kept;
+    }
+
+    for (int d = 0; d < 4; d++)
+    {
+        int bpos;
+        while ((bpos = BBPop(&pushable[d])) >= 0)
+        {
+            int tpos = bpos + SDY[d] * MAX_FIELD + SDX[d]; // куда полетит ящик
+
+            Bitboard child_boxes = boxes;
+            BBReset(&child_boxes, bpos);
+            BBSet(&child_boxes, tpos);
+
+            // Отсекаем дедлоки: если после толчка ящик заморожен вне цели — пропускаем
+            if (IsDeadState(masks, &child_boxes) || IsFreezeDeadlock(ctx, &child_boxes, tpos))
+            {
+                stats->freeze++;
+                continue;
+            }
+
+            // После толчка игрок стоит на прежнем месте ящика;
+            // его позиция нормализуется заливкой
+            uint16_t canon;
+            if (!BBTest(&reach, tpos))
+            {
+                // Ящик ушёл из области игрока: старая область не
+                // разрывается, а новые клетки достижимы только через
+                // bpos — заливаем лишь то, что лежит за пределами reach
+                Bitboard fresh_free;
+                for (int i = 0; i < CELL_WORDS; i++)
+                    fresh_free.w[i] = masks->floor.w[i] & ~child_boxes.w[i] & ~reach.w[i];
+                Bitboard fresh = BBFlood(&fresh_free, bpos, masks);
+                int a = BBFirst(&reach), c = BBFirst(&fresh);
+                canon = (uint16_t)(a < c ? a : c);
+            }
+            else
+            {
+                Bitboard child_reach = PlayerReach(masks, &child_boxes, bpos);
+                canon = (uint16_t)BBFirst(&child_reach);
+            }
+
+            // Ящик переставляется с сохранением порядка; ранг считается
+            // заново, ключ Zobrist меняется четырьмя XOR
+            SearchChild *ch = &out[count++];
+            int b = 0;
+            while (cur->boxes[b] != bpos) b++;
+            ch->state = *cur;
+            MoveBoxSorted(ch->state.boxes, nb, b, (uint16_t)tpos);
+            ch->state.player = canon;
+            if (ctx->ranks.exact)
+                ch->key = RankKey(&ctx->ranks, &ch->state, nb);
+            else
+                ch->key = cur_key ^ zk->box[bpos] ^ zk->box[tpos] ^
+                          zk->player[cur->player] ^ zk->player[canon];
+            ch->direction = d;
+        }
+    }
+    return count;
+}
+
+/*
+ * GoalStates — все целевые состояния: ящики на целях, игрок в одной из
+ * областей свободного пола, соседствующих с ящиком (после последнего
+ * толчка игрок стоит вплотную к ящику). Записывает не больше max
+ * состояний в out (direction = -1) и возвращает их число.
+ */
+int GoalStates(const SearchContext *ctx, SearchChild *out, int max)
+{
+    const BoardMasks *masks = &ctx->masks;
+    int count = 0;
+
+    PackedState st;
+    for (int i = 0, pos = 0; pos < MAX_FIELD * MAX_FIELD; pos++)
+        if (BBTest(&masks->goals, pos)) st.boxes[i++] = (uint16_t)pos;
+
+    Bitboard free;
+    for (int i = 0; i < CELL_WORDS; i++)
+        free.w[i] = masks->floor.w[i] & ~masks->goals.w[i];
+
+    int start;
+    while (count < max && (start = BBFirst(&free)) >= 0)
+    {
+        Bitboard region = BBFlood(&free, start, masks);
+        for (int i = 0; i < CELL_WORDS; i++)
+            free.w[i] &= ~region.w[i];
+
+        bool touches = false;
+        for (int d = 0; d < 4 && !touches; d++)
+        {
+            Bitboard near = BBStep(&region, d, masks);
+            for (int i = 0; i < CELL_WORDS; i++)
+                if (near.w[i] & masks->goals.w[i]) touches = true;
+        }
+        if (!touches) continue;
+
+        // start — наименьшая клетка области, т.е. нормализованная позиция
+        st.player = (uint16_t)start;
+        out[count].state = st;
+        out[count].key = StateKey(ctx, &st);
+        out[count].direction = -1;
+        count++;
+    }
+    return count;
+}
+
+/*
+ * ExpandPulls — обратные ходы из состояния cur: все притягивания ящиков,
+ * то есть состояния, из которых один толчок ведёт в cur. В direction
+ * потомка записывается направление этого толчка (потомок → cur), чтобы
+ * цепочку от целей можно было проиграть вперёд как обычные толчки.
+ *
+ * Толчок в сторону d переводит ящик из b в b + d, а игрока из b - d в b.
+ * Обратно: ящик t (= b + d) тянется в b, если игрок дойдёт до b, а
+ * клетка b - d, куда он отступает, — свободный пол. Ящик, притянутый от
+ * целей, всегда остаётся на живой клетке, поэтому проверяется только
+ * блокировка 2×2 — такое состояние не решается и вперёд.
+ */
+int ExpandPulls(const SearchContext *ctx, const PackedState *cur, uint64_t cur_key, SearchChild *out)
+{
+    const BoardMasks *masks = &ctx->masks;
+    const ZobristKeys *zk = &ctx->zk;
+    int nb = ctx->num_boxes;
+    int count = 0;
+
+    Bitboard boxes = ToBitboard(cur->boxes, nb);
+    Bitboard reach = PlayerReach(masks, &boxes, cur->player);
+    Bitboard free;
+    for (int i = 0; i < CELL_WORDS; i++)
+        free.w[i] = masks->floor.w[i] & ~boxes.w[i];
+
+    for (int d = 0; d < 4; d++)
+    {
+        // Ящик t тянется, если b = t - d достижима, а b - d = t - 2d свободна
+        Bitboard stand = BBStep(&reach, d, masks);
+        Bitboard back1 = BBStep(&free, d, masks);
+        Bitboard back = BBStep(&back1, d, masks);
+        Bitboard pullable;
+        for (int i = 0; i < CELL_WORDS; i++)
+            pullable.w[i] = boxes.w[i] & stand.w[i] & back.w[i];
+
+        int tpos;
+        while ((tpos = BBPop(&pullable)) >= 0)
+        {
+            int delta = SDY[d] * MAX_FIELD + SDX[d];
+            int bpos = tpos - delta;     // куда встанет ящик
+            int ppos = bpos - delta;     // куда отступит игрок
+
+            Bitboard child_boxes = boxes;
+            BBReset(&child_boxes, tpos);
+            BBSet(&child_boxes, bpos);
+            if (IsDeadState(masks, &child_boxes))
+                continue;
+
+            Bitboard child_reach = PlayerReach(masks, &child_boxes, ppos);
+            uint16_t canon = (uint16_t)BBFirst(&child_reach);
+
+            SearchChild *ch = &out[count++];
+            int b = 0;
+            while (cur->boxes[b] != tpos) b++;
+            ch->state = *cur;
+            MoveBoxSorted(ch->state.boxes, nb, b, (uint16_t)bpos);
+            ch->state.player = canon;
+            if (ctx->ranks.exact)
+                ch->key = RankKey(&ctx->ranks, &ch->state, nb);
+            else
+                ch->key = cur_key ^ zk->box[tpos] ^ zk->box[bpos] ^
+                          zk->player[cur->player] ^ zk->player[canon];
+            ch->direction = d;
+        }
+    }
+    return count;
+}
+
+/* ---------- Лимиты и прогресс ---------- */
+
+/*
+ * InitBudget — переводит параметры SolveLevelEx в абсолютные лимиты:
+ * срок в момент NowMs(), нулевой лимит раскрытий — в default_nodes
+ * (встроенный лимит режима).
+ */
+void InitBudget(SearchBudget *b, const SolverOptions *opt, long long default_nodes)
+{
+    b->deadline = opt->time_limit_ms > 0 ? NowMs() + opt->time_limit_ms : 0;
+    b->max_nodes = opt->max_nodes > 0 ? opt->max_nodes : default_nodes;
+    b->max_bytes = opt->max_bytes > 0 ? opt->max_bytes : 0;
+    b->progress = opt->progress;
+}
+
+/*
+ * PollBudget — вызывается раз в PROGRESS_STEP раскрытий: публикует
+ * счётчики для UI (если есть progress) и проверяет отмену и срок.
+ * Возвращает true, если поиск пора прекратить; причина — в *why.
+ * Лимит раскрытий режимы проверяют сами, на каждом раскрытии.
+ */
+bool PollBudget(const SearchBudget *b, long long expanded, int frontier, int f_bound,
+                SolveResult *why)
+{
+    SolverProgress *p = b->progress;
+    if (p)
+    {
+        atomic_store_explicit(&p->expanded, expanded, memory_order_relaxed);
+        atomic_store_explicit(&p->frontier, frontier, memory_order_relaxed);
+        atomic_store_explicit(&p->f_bound, f_bound, memory_order_relaxed);
+        if (atomic_load_explicit(&p->cancel, memory_order_relaxed))
+        {
+            *why = SOLVE_CANCELLED;
+            return true;
+        }
+    }
+    if (b->deadline > 0 && NowMs() >= b->deadline)
+    {
+        *why = SOLVE_BUDGET;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * PatternBudget — предел памяти базы образцов при лимите b: не больше
+ * 1/PDB_BUDGET_SHARE лимита, остальное остаётся хранилищам поиска. Без
+ * лимита таблицы ограничены только PDB_MAX_BYTES.
+ */
+long long PatternBudget(const SearchBudget *b)
+{
+    return b->max_bytes > 0 ? b->max_bytes / PDB_BUDGET_SHARE : LLONG_MAX;
+}
+
+/* OverMemory — bytes (выделено или будет выделено) больше лимита памяти. */
+bool OverMemory(const SearchBudget *b, long long bytes)
+{
+    return b->max_bytes > 0 && bytes > b->max_bytes;
+}
+
+/* NowMs — монотонное время в миллисекундах, для замеров по фазам (SolverStats). */
+double NowMs(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000.0 + t.tv_nsec / 1e6;
+}
+
+/* ---------- Восстановление решения ---------- */
+
+/*
+ * WalkPath — кратчайший путь игрока из from в to в обход стен и ящиков
+ * (поиск в ширину). Записывает направления шагов в out (если он не NULL)
+ * и возвращает их число, либо -1, если клетка to недостижима.
+ */
+static int WalkPath(const Level *level, const uint8_t *occ, uint16_t from, uint16_t to, int *out)
+{
+    int8_t came[MAX_FIELD * MAX_FIELD]; // направление, которым пришли в клетку; -1 — не посещена
+    uint16_t queue[MAX_FIELD * MAX_FIELD];
+    int head = 0, tail = 0;
+
+    memset(came, -1, sizeof(came));
+    came[from] = 4; // стартовая клетка
+    queue[tail++] = from;
+
+    while (head < tail && came[to] < 0)
+    {
+        uint16_t p = queue[head++];
+        int x = p % MAX_FIELD;
+        int y = p / MAX_FIELD;
+        for (int d = 0; d < 4; d++)
+        {
+            int nx = x + SDX[d];
+            int ny = y + SDY[d];
+            if (nx < 0 || nx >= level->width || ny < 0 || ny >= level->height) continue;
+            uint16_t np = (uint16_t)(ny * MAX_FIELD + nx);
+            if (came[np] >= 0 || occ[np] || level->cells[ny][nx] == CELL_WALL) continue;
+            came[np] = (int8_t)d;
+            queue[tail++] = np;
+        }
+    }
+    if (came[to] < 0) return -1;
+
+    // Разворачиваем путь от to к from, затем переписываем в прямом порядке
+    int len = 0;
+    for (uint16_t p = to; p != from; len++)
+        p = (uint16_t)(p - (SDY[came[p]] * MAX_FIELD + SDX[came[p]]));
+    if (!out) return len;
+    int i = len;
+    for (uint16_t p = to; p != from; )
+    {
+        int d = came[p];
+        out[--i] = d;
+        p = (uint16_t)(p - (SDY[d] * MAX_FIELD + SDX[d]));
+    }
+    return len;
+}
+
+/* PushedBox — клетка ящика в child, которой нет среди занятых occ (куда его толкнули). */
+static uint16_t PushedBox(const uint8_t *occ, const PackedState *child, int nb)
+{
+    for (int i = 0; i < nb; i++)
+        if (!occ[child->boxes[i]]) return child->boxes[i];
+    return 0;
+}
+
+/*
+ * PushMoves — шаги игрока для толчков from+1..to цепочки path (path[k] —
+ * состояние после k-го толчка, dirs[k] — его направление). Состояния
+ * хранят только нормализованную позицию игрока, поэтому шаги строятся
+ * заново: для каждого толчка находим сдвинутый ящик (есть в дочернем
+ * состоянии, но не в родительском), подводим игрока к нему кратчайшим
+ * путём WalkPath и добавляем сам толчок. Игрок начинает с клетки, где
+ * стоит после толчка from (при from = 0 — с реальной клетки уровня).
+ * Шаги пишутся в out, если он не NULL (не больше MAX_FIELD * MAX_FIELD на
+ * толчок). Возвращает их число или -1, если к толчку не подойти.
+ */
+int PushMoves(const SearchContext *ctx, const PackedState *path, const int *dirs,
+              int from, int to, int *out)
+{
+    const Level *level = ctx->level;
+    int nb = ctx->num_boxes;
+    uint8_t occ[MAX_FIELD * MAX_FIELD] = {0};
+    uint16_t player = (uint16_t)(level->player.y * MAX_FIELD + level->player.x);
+
+    if (from > 0)
+    {
+        for (int i = 0; i < nb; i++)
+            occ[path[from - 1].boxes[i]] = 1;
+        int d = dirs[from];
+        player = (uint16_t)(PushedBox(occ, &path[from], nb) - (SDY[d] * MAX_FIELD + SDX[d]));
+        memset(occ, 0, sizeof(occ));
+    }
+    for (int i = 0; i < nb; i++)
+        occ[path[from].boxes[i]] = 1;
+
+    int num_moves = 0;
+    for (int k = from + 1; k <= to; k++)
+    {
+        int d = dirs[k];
+        int delta = SDY[d] * MAX_FIELD + SDX[d];
+        uint16_t box_to = PushedBox(occ, &path[k], nb);
+        uint16_t box_from = (uint16_t)(box_to - delta);
+
+        int walk = WalkPath(level, occ, player, (uint16_t)(box_from - delta),
+                            out ? out + num_moves : NULL);
+        if (walk < 0) return -1;
+        num_moves += walk;
+        if (out) out[num_moves] = d;
+        num_moves++;
+
+        occ[box_from] = 0;
+        occ[box_to] = 1;
+        player = box_from;
+    }
+    return num_moves;
+}
+
+/*
+ * BuildMoves — превращает цепочку толчков в последовательность шагов
+ * игрока для воспроизведения (PushMoves от реального старта уровня).
+ * path[0] — корень, path[k] — состояние после k-го толчка, dirs[k] —
+ * направление этого толчка (dirs[0] не читается). Цепочка запоминается в
+ * ctx->memo, если он есть.
+ */
+bool BuildMoves(const SearchContext *ctx, const PackedState *path, const int *dirs,
+                int num_pushes, Solver *solver)
+{
+    // Между толчками игрок проходит не больше MAX_FIELD*MAX_FIELD шагов
+    int *moves = (int *)malloc(sizeof(int) * ((size_t)num_pushes * MAX_FIELD * MAX_FIELD + 1));
+    if (!moves) return false;
+
+    // -1 не должно случаться: толчок порождён из достижимой клетки
+    int num_moves = PushMoves(ctx, path, dirs, 0, num_pushes, moves);
+    if (num_moves < 0)
+    {
+        free(moves);
+        return false;
+    }
+
+    if (ctx->memo) RememberPath(ctx->memo, path, dirs, num_pushes);
+
+    int *shrunk = (int *)realloc(moves, sizeof(int) * (num_moves > 0 ? num_moves : 1));
+    solver->moves = shrunk ? shrunk : moves;
+    solver->num_moves = num_moves;
+    solver->current_move = 0;
+    solver->active = true;
+    solver->timer = 0;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "types.h"
+#include <limits.h>
+
+/* Эвристика для состояния, из которого цели недостижимы. */
+#define H_INF INT_MAX
+
+/* Лимит раскрытых узлов — защита от зависания на неразрешимых уровнях. */
+#define MAX_ITERATIONS 100000000
+
+/* Раз в столько раскрытий поиск публикует прогресс и проверяет срок и отмену. */
+#define PROGRESS_STEP 1024
+
+void InitSearch(const Level *level, SearchContext *ctx, SolverMemo *memo, long long pdb_bytes);
+void InitPullSearch(const Level *level, SearchContext *ctx);
+void FreeSearch(SearchContext *ctx);
+bool SolveFromMemo(const Level *level, SolverMemo *memo, bool need_optimal, Solver *solver,
+                   int *pushes);
+int Heuristic(const PushTable *pt, const uint16_t *boxes, int n);
+int StateHeuristic(const SearchContext *ctx, const PackedState *ps);
+uint64_t StateKey(const SearchContext *ctx, const PackedState *ps);
+PackedState CurrentState(const SearchContext *ctx, const Level *level);
+void NodeState(const SearchContext *ctx, const NodePool *pool, int idx, PackedState *out);
+bool IsGoalState(const SearchContext *ctx, const PackedState *ps);
+int ExpandState(const SearchContext *ctx, const PackedState *cur, uint64_t cur_key,
+                SearchChild *out, PruneStats *stats);
+int GoalStates(const SearchContext *ctx, SearchChild *out, int max);
+int ExpandPulls(const SearchContext *ctx, const PackedState *cur, uint64_t cur_key, SearchChild *out);
+double NowMs(void);
+void InitBudget(SearchBudget *b, const SolverOptions *opt, long long default_nodes);
+bool PollBudget(const SearchBudget *b, long long expanded, int frontier, int f_bound,
+                SolveResult *why);
+long long PatternBudget(const SearchBudget *b);
+bool OverMemory(const SearchBudget *b, long long bytes);
+
+SolveResult RunIDA(const Level *level, Solver *solver, const SolverOptions *opt, SolverStats *stats);
+SolveResult RunHDA(const Level *level, Solver *solver, const SolverOptions *opt, SolverStats *stats);
+SolveResult RunBidirectional(const Level *level, Solver *solver, const SolverOptions *opt,
+                             SolverStats *stats);
+int PushMoves(const SearchContext *ctx, const PackedState *path, const int *dirs,
+              int from, int to, int *out);
+bool BuildMoves(const SearchContext *ctx, const PackedState *path, const int *dirs,
+                int num_pushes, Solver *solver);
+
+#endif
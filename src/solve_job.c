@@ -0,0 +1,107 @@
+/*
+ * solve_job.c — решатель в фоновом потоке.
+ *
+ * На трудных уровнях поиск идёт минутами; если звать его прямо из
+ * главного цикла, окно замирает: нет отрисовки, музыки и ввода. Здесь
+ * поиск запускается в отдельном потоке на копии уровня, а главный цикл
+ * каждый кадр читает прогресс (SolverProgress: раскрытые узлы, фронт,
+ * текущее f) и проверяет, не закончился ли поиск.
+ *
+ * Отмена кооперативная: UI выставляет progress.cancel, поиск замечает её
+ * в ближайшей проверке (раз в PROGRESS_STEP раскрытий), выходит из цикла
+ * и освобождает пул, open и closed list как при обычном завершении.
+ * CancelSolveJob дожидается этого, поэтому к возврату память уже отдана.
+ */
+
+#include "solve_job.h"
+#include "solver.h"
+#include "optimize.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define OPTIMIZE_BUDGET_MS 500.0 // на укорачивание неоптимального решения
+
+/*
+ * SolveThread — тело фонового потока: поиск и замер времени. Решение,
+ * оптимальность которого не доказана (anytime не успел), ещё до
+ * воспроизведения укорачивается OptimizeSolution; время входит в
+ * elapsed_ms.
+ */
+static void *SolveThread(void *arg)
+{
+    SolveJob *job = (SolveJob *)arg;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    job->result = SolveLevelEx(&job->level, &job->solver, &job->options, &job->stats);
+    if (job->result == SOLVE_FOUND && job->stats.pushes > job->stats.lower_bound)
+    {
+        OptimizeOptions opt = {.time_limit_ms = OPTIMIZE_BUDGET_MS,
+                               .progress = &job->progress,
+                               .memo = job->options.memo};
+        OptimizeSolution(&job->level, &job->solver, &opt, &job->optimize);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    job->elapsed_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 +
+                      (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    atomic_store(&job->done, true);
+    return NULL;
+}
+
+/*
+ * StartSolveJob — запускает поиск решения level в фоновом потоке
+ * (options — режим и лимиты; options->progress не используется, прогресс
+ * пишется в job->progress). Уровень копируется, поэтому игра может
+ * дальше работать со своим. Возвращает false, если поток не создался.
+ */
+bool StartSolveJob(SolveJob *job, const Level *level, const SolverOptions *options)
+{
+    memset(job, 0, sizeof(*job));
+    job->level = *level;
+    job->level.undo_head = NULL; // стек отмены остаётся у игры
+    job->level.undo_count = 0;
+    job->options = *options;
+    job->options.progress = &job->progress;
+    atomic_init(&job->progress.expanded, 0);
+    atomic_init(&job->progress.frontier, 0);
+    atomic_init(&job->progress.f_bound, 0);
+    atomic_init(&job->progress.cancel, false);
+    atomic_init(&job->progress.best_pushes, 0);
+    atomic_init(&job->progress.lower_bound, 0);
+    atomic_init(&job->done, false);
+
+    if (pthread_create(&job->thread, NULL, SolveThread, job) != 0)
+        return false;
+    job->running = true;
+    return true;
+}
+
+/*
+ * SolveJobDone — true, если поиск закончился; поток при этом
+ * присоединяется, а результат лежит в job->result и job->solver.
+ * Не блокирует: пока поиск идёт, сразу возвращает false.
+ */
+bool SolveJobDone(SolveJob *job)
+{
+    if (!job->running || !atomic_load(&job->done)) return false;
+    pthread_join(job->thread, NULL);
+    job->running = false;
+    return true;
+}
+
+/*
+ * CancelSolveJob — прерывает поиск и ждёт выхода потока (не дольше
+ * PROGRESS_STEP раскрытий). Найденное к этому моменту решение
+ * выбрасывается.
+ */
+void CancelSolveJob(SolveJob *job)
+{
+    if (!job->running) return;
+    atomic_store(&job->progress.cancel, true);
+    pthread_join(job->thread, NULL);
+    job->running = false;
+    if (job->result == SOLVE_FOUND) FreeSolver(&job->solver);
+    job->result = SOLVE_CANCELLED;
+}
@@ -0,0 +1,10 @@
+#ifndef SOLVE_JOB_H
+#define SOLVE_JOB_H
+
+#include "types.h"
+
+bool StartSolveJob(SolveJob *job, const Level *level, const SolverOptions *options);
+bool SolveJobDone(SolveJob *job);
+void CancelSolveJob(SolveJob *job);
+
+#endif
@@ -1,694 +1,427 @@
 /*
  * solver.c — автоматический решатель уровней Sokoban.
  *
- * Алгоритм: A* (A-star) по пространству состояний игры.
+ * Алгоритм: A* (A-star) по пространству толчков.
  *
- * Состояние (PackedState) — это позиция игрока + отсортированный массив
- * позиций всех ящиков. Два состояния равны, если игрок стоит в том же
- * месте и все ящики расставлены одинаково.
+ * Один узел поиска — это один толчок ящика, а не один шаг игрока; позиция
+ * игрока в состоянии нормализована до его области достижимости.
+ * Представление состояния, генерация толчков, эвристика и восстановление
+ * шагов игрока общие с режимами IDA* (ida.c) и HDA* (hda.c) и вынесены в
+ * search.c; хранилища узлов (NodePool, BucketQueue, HashSet) — в nodes.c.
  *
- * Позиция кодируется одним uint16_t: pos = y * MAX_FIELD + x.
+ * Стоимость пути g — число толчков, эвристика допустима, поэтому A*
+ * находит решение с минимальным числом толчков. Состояния, где ящики
+ * нельзя развести по целям, получают h = H_INF и отсекаются.
  *
- * Структуры данных:
- *   NodePool  — плоский массив всех порождённых узлов A*.
- *               Каждый узел хранит состояние, индекс родителя,
- *               направление хода и значения g, f.
- *   MinHeap   — бинарная куча (min-heap) по f; хранит индексы в NodePool.
- *               Это «открытый список» (open list) A*.
- *   HashSet   — хеш-таблица с открытой адресацией; хранит PackedState.
- *               Это «закрытый список» (closed list) A* — уже посещённые
- *               состояния, чтобы не обрабатывать их повторно.
- *
- * Эвристика h(n) — сумма Manhattan-расстояний каждого ящика до его
- * ближайшей цели. Эвристика допустима (не завышает реальную стоимость),
- * поэтому A* находит оптимальный путь.
- *
- * Дополнительная оптимизация: обнаружение дедлоков (IsDeadState) —
- * если после толчка ящик попал в позицию, из которой его никогда не
- * вытолкнуть на цель, ветка отсекается без раскрытия.
+ * A* быстрее IDA*, но хранит все порождённые состояния: на трудных
+ * уровнях память растёт до нескольких гигабайт (см. NODES_MAX_CAP).
  */
 
 #include "solver.h"
+#include "search.h"
+#include "nodes.h"
+#include "pdb.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
-#include <limits.h>
 #include <stdio.h>
 
-/* Начальные/максимальные ёмкости динамических структур. */
-#define NODES_INIT_CAP  500000
-#define NODES_MAX_CAP   100000000
-#define HEAP_INIT_CAP   500000
-#define HASH_INIT_CAP   1048576   // 2^20, степень двойки
-
-/* Лимит итераций — защита от зависания на неразрешимых уровнях. */
-#define MAX_ITERATIONS  100000000
-
-/* Векторы смещений для четырёх направлений: вверх, вниз, влево, вправо. */
-static const int SDX[4] = {0, 0, -1, 1};
-static const int SDY[4] = {-1, 1, 0, 0};
-
-/* ---------- Вспомогательные функции для работы с ящиками ---------- */
+/* ---------- Главная функция: A* поиск решения ---------- */
 
 /*
- * SortBoxes — сортировка массива позиций ящиков вставками.
- * Порядок позиций не важен для игры, но важен для сравнения состояний:
- * одни и те же ящики всегда дают одинаковую PackedState независимо от
- * порядка их толчков.
+ * RunAStar — A* поиск от текущего состояния уровня в пределах лимитов
+ * opt; счётчики пишутся в stats (может быть NULL).
+ *
+ * Возвращает SOLVE_FOUND и заполняет solver->moves последовательностью
+ * направлений (индексы 0..3 = вверх/вниз/влево/вправо), если решение
+ * найдено; SOLVE_UNSOLVABLE, если open list опустел (обрезка дедлоков
+ * и PI-коррали решений не теряют); иначе — причину остановки.
+ *
+ * Общая схема A*:
+ *   1. Создать начальный узел, поместить в open list (BucketQueue).
+ *   2. Пока open list не пуст:
+ *      a. Извлечь узел cur с наименьшим f = g + h.
+ *      b. Если cur — целевое состояние (ящики == цели) — путь найден.
+ *      c. Получить все толчки из cur без дедлоков (ExpandState).
+ *         Для каждого дочернего состояния:
+ *         - Если оно уже встречалось с g не хуже — пропустить.
+ *         - Иначе создать дочерний узел и добавить в open list.
+ *   3. Если путь найден, восстановить толчки по цепочке parent и
+ *      развернуть их в шаги игрока (BuildMoves).
+ *
+ * Лимит памяти проверяется до роста пула и хеш-таблицы — по тому, сколько
+ * они действительно выделили бы (PoolGrowthBytes, HashSetGrowthBytes).
+ *
+ * При opt->weight > 1 это взвешенный A*: f = g + weight * h. Поиск
+ * раскрывает гораздо меньше узлов, а решение длиннее оптимума не больше
+ * чем в weight раз (состояния, найденные позже с меньшим g, по-прежнему
+ * переоткрываются). cutoff > 0 — длина уже известного решения: ветки с
+ * g + h >= cutoff его не улучшат и отсекаются (режим anytime).
  */
-static void SortBoxes(uint16_t *boxes, int n)
+static SolveResult RunAStar(const Level *level, Solver *solver, const SolverOptions *opt,
+                            SolverStats *stats, int cutoff)
 {
-    for (int i = 1; i < n; i++)
-    {
-        uint16_t key = boxes[i];
-        int j = i - 1;
-        while (j >= 0 && boxes[j] > key)
-        {
-            boxes[j + 1] = boxes[j];
-            j--;
-        }
-        boxes[j + 1] = key;
-    }
-}
+    int nb = level->num_boxes;
+    SolveResult result = SOLVE_OUT_OF_MEMORY;
+    SolverStats st = {0};
+    double t_start = NowMs(), t_init = t_start, t_search = t_start;
+    double weight = opt->weight > 1.0 ? opt->weight : 1.0;
 
-/*
- * IsBoxAt — линейный поиск ящика по позиции pos.
- * Возвращает индекс в массиве boxes или -1, если ящика нет.
- * (Количество ящиков мало — до MAX_BOXES=10 — поэтому O(n) достаточно.)
- */
-static int IsBoxAt(const uint16_t *boxes, int n, uint16_t pos)
-{
-    for (int i = 0; i < n; i++)
-        if (boxes[i] == pos) return i;
-    return -1;
-}
+    SearchBudget budget;
+    InitBudget(&budget, opt, MAX_ITERATIONS);
 
-/*
- * IsGoal — проверяет, является ли позиция pos одной из целевых клеток.
- */
-static int IsGoal(const uint16_t *goals, int n, uint16_t pos)
-{
-    for (int i = 0; i < n; i++)
-        if (goals[i] == pos) return 1;
-    return 0;
-}
+    // Таблица расстояний, маски, ключи и корень — один раз на уровень
+    SearchContext ctx;
+    InitSearch(level, &ctx, opt->memo, PatternBudget(&budget));
 
-/* ---------- Эвристика A* ---------- */
+    // Инициализация трёх структур данных; при точных ключах пул не
+    // хранит состояний
+    NodePool *pool  = CreateNodePool(NODES_MAX_CAP, !ctx.ranks.exact);
+    BucketQueue *open = CreateBucketQueue();
+    HashSet  *closed = CreateHashSet(InitialHashCap(budget.max_bytes, 1));
 
-/*
- * Heuristic — нижняя оценка оставшейся стоимости пути (h(n)).
- *
- * Для каждого ящика берём Manhattan-расстояние до ближайшей цели и
- * суммируем. Это допустимая эвристика: реальное число ходов не может
- * быть меньше этой суммы, поэтому A* гарантированно найдёт кратчайший
- * путь.
- *
- * Недостаток: не учитывает конкуренцию ящиков за одну цель. Для Sokoban
- * это может привести к тому, что несколько ящиков «претендуют» на одну
- * ближайшую цель — эвристика занижена, но остаётся допустимой.
- */
-static int Heuristic(const uint16_t *boxes, const uint16_t *goals, int n)
-{
-    int h = 0;
-    for (int i = 0; i < n; i++)
+    if (!pool || !open || !closed)
+        goto cleanup;
+    t_init = t_search = NowMs();
+
+    // Создаём корневой узел (начальное состояние)
     {
-        int bx = boxes[i] % MAX_FIELD;
-        int by = boxes[i] / MAX_FIELD;
-        int best = INT_MAX;
-        for (int j = 0; j < n; j++)
+        AStarNode root;
+        root.key = ctx.root_key;
+        root.parent_owner = 0;
+        root.parent = -1;      // корень не имеет родителя
+        root.direction = -1;   // корень не имеет направления
+        root.g = 0;            // стоимость пути от старта = 0
+        int h = StateHeuristic(&ctx, &ctx.root);
+        if (h == H_INF || (cutoff > 0 && h >= cutoff)) // ящики не развести по целям
         {
-            int gx = goals[j] % MAX_FIELD;
-            int gy = goals[j] / MAX_FIELD;
-            int dist = abs(bx - gx) + abs(by - gy);
-            if (dist < best) best = dist;
+            result = SOLVE_UNSOLVABLE;
+            goto cleanup;
         }
-        h += best;
+        st.lower_bound = h;
+        root.f = (int)(weight * h); // f = g + w * h = 0 + w * h
+
+        int root_idx = PoolAdd(pool, &root, &ctx.root);
+        if (root_idx < 0) goto cleanup;
+        if (!BucketPush(open, root.f, root.g, root_idx)) goto cleanup;
+        uint32_t slot;
+        HashSetFind(closed, pool, root.key, &ctx.root, nb, &slot);
+        HashSetPut(closed, slot, root.key, root_idx); // сразу помечаем как посещённый
     }
-    return h;
-}
 
-/* ---------- Обнаружение дедлоков ---------- */
+    int found = -1;      // индекс найденного целевого узла (-1 = не найден)
+    long long iterations = 0;
+    SearchChild children[MAX_CHILDREN];
+    result = SOLVE_UNSOLVABLE; // если open list опустеет
 
-/*
- * IsDeadState — проверяет, является ли расстановка ящиков тупиковой
- * (дедлоком), то есть состоянием, из которого решение уже невозможно.
- *
- * Реализованы два вида дедлоков:
- *
- * 1. Угловой дедлок (corner deadlock):
- *    Ящик упёрся в угол из двух стен. Вытолкнуть его из угла невозможно.
- *    Пример: ящик в клетке, где слева и сверху стены.
- *
- * 2. Блокировка 2×2 (freeze deadlock):
- *    Четыре клетки в квадрате 2×2 заняты стенами или ящиками, и хотя бы
- *    один ящик в этом квадрате не стоит на цели. Ни один ящик в таком
- *    квадрате никогда не сдвинется.
- *
- * Проверка выполняется только для ящиков не на цели — ящик на цели не
- * создаёт дедлок даже в углу.
- *
- * Эти проверки значительно сокращают дерево поиска, отсекая заведомо
- * проигрышные ветки.
- */
-static int IsDeadState(const Level *level, const uint16_t *boxes, int nb, const uint16_t *goals)
-{
-    for (int i = 0; i < nb; i++)
+    // Главный цикл A*
+    while (open->size > 0)
     {
-        if (IsGoal(goals, nb, boxes[i])) continue; // ящик уже на цели — пропускаем
+        if (iterations >= budget.max_nodes) { result = SOLVE_BUDGET; break; }
 
-        int x = boxes[i] % MAX_FIELD;
-        int y = boxes[i] / MAX_FIELD;
+        // Извлекаем узел с наименьшим f из open list
+        int cur_idx = BucketPop(open);
+        if (cur_idx < 0) break;
 
-        // 1) Угловой дедлок: две смежные стены вокруг ящика
-        int w_up    = (level->cells[y - 1][x] == CELL_WALL);
-        int w_down  = (level->cells[y + 1][x] == CELL_WALL);
-        int w_left  = (level->cells[y][x - 1] == CELL_WALL);
-        int w_right = (level->cells[y][x + 1] == CELL_WALL);
+        // Узлы пула не переезжают, поэтому указатель действителен и
+        // после PoolAdd в цикле по потомкам
+        const AStarNode *cur = PoolNode(pool, cur_idx);
+        uint64_t cur_key = cur->key;
+        int cur_g = cur->g;
 
-        if ((w_up && w_left) || (w_up && w_right) ||
-            (w_down && w_left) || (w_down && w_right))
-            return 1;
+        // Пропускаем устаревшую копию: состояние позже найдено с меньшим g
+        PackedState cur_state;
+        NodeState(&ctx, pool, cur_idx, &cur_state);
+        uint32_t slot;
+        if (HashSetFind(closed, pool, cur_key, &cur_state, nb, &slot) != cur_idx)
+            continue;
 
-        // 2) Дедлок 2×2: проверяем все четыре квадрата, в которых участвует
-        //    текущий ящик (ящик может быть в любом из четырёх углов квадрата)
-        int offsets[4][2] = {{0,0}, {-1,0}, {0,-1}, {-1,-1}};
-        for (int q = 0; q < 4; q++)
-        {
-            int bx = x + offsets[q][0]; // левый верхний угол квадрата
-            int by = y + offsets[q][1];
-            if (bx < 0 || bx + 1 >= level->width || by < 0 || by + 1 >= level->height)
-                continue;
+        iterations++;
+        if (open->size >= st.open_peak) st.open_peak = open->size + 1; // с извлечённым
+        if (iterations % PROGRESS_STEP == 0 &&
+            PollBudget(&budget, iterations, open->size, cur->f, &result))
+            break; // отмена из UI или истёк срок
 
-            // Четыре клетки квадрата
-            uint16_t cells[4] = {
-                (uint16_t)(by       * MAX_FIELD + bx),
-                (uint16_t)(by       * MAX_FIELD + bx + 1),
-                (uint16_t)((by + 1) * MAX_FIELD + bx),
-                (uint16_t)((by + 1) * MAX_FIELD + bx + 1)
-            };
+        if (IsGoalState(&ctx, &cur_state)) { found = cur_idx; break; }
 
-            int all_blocked = 1, any_box_off_goal = 0;
-            for (int c = 0; c < 4; c++)
+        // Раскрытие узла: все толчки без дедлоков
+        int num_children = ExpandState(&ctx, &cur_state, cur_key, children, &st.prune);
+        st.generated += num_children;
+        for (int c = 0; c < num_children; c++)
+        {
+            const SearchChild *ch = &children[c];
+
+            // Проверяем, встречали ли мы это состояние с g не хуже
+            int seen = HashSetFind(closed, pool, ch->key, &ch->state, nb, &slot);
+            if (seen >= 0 && PoolNode(pool, seen)->g <= cur_g + 1)
             {
-                int cx = cells[c] % MAX_FIELD;
-                int cy = cells[c] / MAX_FIELD;
-                int is_wall = (level->cells[cy][cx] == CELL_WALL);
-                int is_box  = (IsBoxAt(boxes, nb, cells[c]) != -1);
-
-                if (!is_wall && !is_box) { all_blocked = 0; break; } // есть свободная клетка — не дедлок
-                if (is_box && !IsGoal(goals, nb, cells[c]))
-                    any_box_off_goal = 1; // ящик вне цели в этом квадрате
+                st.duplicates++;
+                continue;
             }
-            if (all_blocked && any_box_off_goal) return 1; // дедлок 2×2
-        }
-    }
-    return 0;
-}
-
-/* ---------- NodePool — пул узлов A* ---------- */
-
-/*
- * Все узлы хранятся в одном динамическом массиве (NodePool).
- * Узел адресуется целочисленным индексом — это безопаснее указателей,
- * так как realloc может переместить блок памяти.
- * Поле parent в AStarNode — тоже индекс, а не указатель.
- */
-
-static NodePool *CreateNodePool(int cap)
-{
-    NodePool *p = (NodePool *)calloc(1, sizeof(NodePool));
-    if (!p) return NULL;
-    p->data = (AStarNode *)malloc(sizeof(AStarNode) * cap);
-    if (!p->data) { free(p); return NULL; }
-    p->capacity = cap;
-    return p;
-}
-
-static void FreeNodePool(NodePool *p)
-{
-    if (!p) return;
-    free(p->data);
-    free(p);
-}
 
-/*
- * PoolAdd — добавляет узел в пул, при необходимости удваивая ёмкость.
- * Возвращает индекс нового узла или -1 при ошибке.
- *
- * ВАЖНО: после PoolAdd адрес pool->data может измениться из-за realloc.
- * Поэтому перед вызовом PoolAdd нужно скопировать все нужные данные
- * из pool->data на стек (как это делается в главном цикле).
- */
-static int PoolAdd(NodePool *p, const AStarNode *node)
-{
-    if (p->count >= p->capacity)
-    {
-        if (p->capacity >= NODES_MAX_CAP) return -1;
-        int new_cap = p->capacity * 2;
-        if (new_cap > NODES_MAX_CAP) new_cap = NODES_MAX_CAP;
-        AStarNode *tmp = (AStarNode *)realloc(p->data, sizeof(AStarNode) * new_cap);
-        if (!tmp) return -1;
-        p->data = tmp;
-        p->capacity = new_cap;
-    }
-    p->data[p->count] = *node;
-    return p->count++;
-}
+            // Ящики нельзя развести по целям — ветка нерешаема
+            int h = StateHeuristic(&ctx, &ch->state);
+            if (h == H_INF || (cutoff > 0 && cur_g + 1 + h >= cutoff)) { st.pruned_h++; continue; }
 
-/* ---------- MinHeap — приоритетная очередь (open list) ---------- */
+            // Рост пула или таблицы вместе с базой образцов не должен выйти
+            // за лимит памяти
+            if (OverMemory(&budget, pool->bytes + open->bytes + closed->bytes + ctx.pdb.bytes +
+                                    PoolGrowthBytes(pool) + HashSetGrowthBytes(closed)))
+                goto no_memory;
 
-/*
- * Бинарная куча хранит индексы узлов из NodePool, упорядоченные по f.
- * HeapPop всегда возвращает узел с наименьшим f — следующий кандидат
- * для раскрытия в A*.
- */
-
-static MinHeap *CreateHeap(int cap)
-{
-    MinHeap *h = (MinHeap *)calloc(1, sizeof(MinHeap));
-    if (!h) return NULL;
-    h->idx = (int *)malloc(sizeof(int) * cap);
-    if (!h->idx) { free(h); return NULL; }
-    h->capacity = cap;
-    return h;
-}
-
-static void FreeHeap(MinHeap *h)
-{
-    if (!h) return;
-    free(h->idx);
-    free(h);
-}
+            // Создаём дочерний узел: g увеличивается на 1 (один толчок),
+            // f = g + h(нового состояния)
+            AStarNode child;
+            child.key = ch->key;
+            child.parent_owner = 0;
+            child.parent = cur_idx;       // ссылка на родителя для восстановления пути
+            child.direction = ch->direction; // направление, которым был сделан толчок
+            child.g = cur_g + 1;
+            child.f = child.g + (int)(weight * h);
 
-/*
- * HeapSiftUp — восстанавливает свойство кучи снизу вверх после вставки.
- * Новый элемент в позиции pos «всплывает» к корню, пока его f < f родителя.
- */
-static void HeapSiftUp(MinHeap *h, const NodePool *pool, int pos)
-{
-    while (pos > 0)
-    {
-        int parent = (pos - 1) / 2;
-        if (pool->data[h->idx[parent]].f <= pool->data[h->idx[pos]].f) break;
-        int tmp = h->idx[parent];
-        h->idx[parent] = h->idx[pos];
-        h->idx[pos] = tmp;
-        pos = parent;
-    }
-}
+            int child_idx = PoolAdd(pool, &child, &ch->state);
+            if (child_idx < 0) goto no_memory; // закончилась память
 
-/*
- * HeapSiftDown — восстанавливает свойство кучи сверху вниз после извлечения
- * минимума. Корень заменяется последним элементом, затем «тонет» вниз.
- */
-static void HeapSiftDown(MinHeap *h, const NodePool *pool, int pos)
-{
-    while (1)
-    {
-        int best = pos;
-        int left = 2 * pos + 1;
-        int right = 2 * pos + 2;
-        if (left < h->size && pool->data[h->idx[left]].f < pool->data[h->idx[best]].f)
-            best = left;
-        if (right < h->size && pool->data[h->idx[right]].f < pool->data[h->idx[best]].f)
-            best = right;
-        if (best == pos) break;
-        int tmp = h->idx[pos];
-        h->idx[pos] = h->idx[best];
-        h->idx[best] = tmp;
-        pos = best;
-    }
-}
+            if (seen < 0 && closed->count * 2 >= closed->capacity) // load factor > 0.5
+            {
+                if (!HashSetGrow(closed)) goto no_memory;
+                HashSetFind(closed, pool, ch->key, &ch->state, nb, &slot);
+            }
+            HashSetPut(closed, slot, ch->key, child_idx);
 
-/* HeapPush — добавляет индекс узла в очередь и восстанавливает порядок. */
-static int HeapPush(MinHeap *h, const NodePool *pool, int node_idx)
-{
-    if (h->size >= h->capacity)
-    {
-        int new_cap = h->capacity * 2;
-        int *tmp = (int *)realloc(h->idx, sizeof(int) * new_cap);
-        if (!tmp) return 0;
-        h->idx = tmp;
-        h->capacity = new_cap;
+            if (!BucketPush(open, child.f, child.g, child_idx))
+                goto no_memory;
+        }
     }
-    h->idx[h->size] = node_idx;
-    HeapSiftUp(h, pool, h->size);
-    h->size++;
-    return 1;
-}
+    goto done;
 
-/*
- * HeapPop — извлекает индекс узла с наименьшим f.
- * Корень (минимум) сохраняется, на его место ставится последний элемент,
- * затем выполняется sift-down.
- */
-static int HeapPop(MinHeap *h, const NodePool *pool)
-{
-    if (h->size <= 0) return -1;
-    int result = h->idx[0];
-    h->size--;
-    if (h->size > 0)
+no_memory:
+    result = SOLVE_OUT_OF_MEMORY;
+done:
+    t_search = NowMs();
+    if (found >= 0)
     {
-        h->idx[0] = h->idx[h->size];
-        HeapSiftDown(h, pool, 0);
+        /*
+         * Восстановление пути от финального узла до корня: цепочка
+         * parent даёт толчки, BuildMoves разворачивает их в шаги игрока.
+         */
+        int num_pushes = PoolNode(pool, found)->g;
+        PackedState *path = (PackedState *)malloc(sizeof(PackedState) * (num_pushes + 1));
+        int *dirs = (int *)malloc(sizeof(int) * (num_pushes + 1));
+        result = SOLVE_OUT_OF_MEMORY;
+        if (path && dirs)
+        {
+            for (int k = num_pushes, idx = found; k >= 0; k--, idx = PoolNode(pool, idx)->parent)
+            {
+                NodeState(&ctx, pool, idx, &path[k]);
+                dirs[k] = PoolNode(pool, idx)->direction;
+            }
+            if (BuildMoves(&ctx, path, dirs, num_pushes, solver))
+            {
+                result = SOLVE_FOUND;
+                st.solutions = 1;
+                st.pushes = num_pushes;
+                // Решение не длиннее weight * оптимум: оптимум не короче pushes / weight
+                int bound = (int)(num_pushes / weight);
+                if (bound * weight < num_pushes) bound++;
+                if (bound > st.lower_bound) st.lower_bound = bound;
+            }
+        }
+        free(path);
+        free(dirs);
     }
-    return result;
-}
 
-/* ---------- HashSet — закрытый список посещённых состояний ---------- */
+    printf("[solver] iterations=%lld  pool=%d  hash=%d  freeze=%lld  corral=%lld  found=%s\n",
+           iterations, pool->count, closed->count, st.prune.freeze, st.prune.corral,
+           found >= 0 ? "YES" : "NO");
 
-/*
- * Хеш-таблица с открытой адресацией (линейное зондирование).
- * Ёмкость всегда степень двойки, поэтому вместо деления используется
- * побитовое AND с mask = capacity - 1.
- *
- * Назначение: прежде чем добавлять новое состояние в open list,
- * проверяем, не было ли оно уже раскрыто. Если было — пропускаем.
- * Это предотвращает повторное раскрытие одного состояния и делает
- * алгоритм корректным (каждое состояние обрабатывается не более одного раза).
- */
+    st.expanded = iterations;
+    st.pool_peak = pool->count;
+    st.reallocs = pool->num_chunks + open->reallocs;
+    st.rehashes = closed->rehashes;
+    st.bytes = pool->bytes + open->bytes + closed->bytes;
 
-/*
- * HashPacked — хеш FNV-1a для PackedState.
- * Смешиваем позицию игрока и все позиции ящиков.
- * FNV-1a обеспечивает хорошее распределение для небольших структур.
- */
-static uint32_t HashPacked(const PackedState *ps, int nb)
-{
-    uint32_t h = 2166136261u; // FNV offset basis
-    h ^= ps->player;
-    h *= 16777619u;           // FNV prime
-    for (int i = 0; i < nb; i++)
+cleanup:
+    if (stats)
     {
-        h ^= ps->boxes[i];
-        h *= 16777619u;
+        double t_end = NowMs();
+        st.init_ms = t_init - t_start;
+        st.search_ms = t_search - t_init;
+        st.path_ms = t_end - t_search;
+        st.pdb_ms = ctx.pdb.build_ms;
+        st.pdb_bytes = ctx.pdb.bytes;
+        *stats = st;
     }
-    return h;
+    FreeNodePool(pool);
+    FreeBucketQueue(open);
+    FreeHashSet(closed);
+    FreeSearch(&ctx);
+    return result;
 }
 
-/* PackedEqual — побайтовое сравнение двух состояний. */
-static int PackedEqual(const PackedState *a, const PackedState *b, int nb)
-{
-    if (a->player != b->player) return 0;
-    for (int i = 0; i < nb; i++)
-        if (a->boxes[i] != b->boxes[i]) return 0;
-    return 1;
-}
+/* ---------- Anytime: быстрое первое решение и его улучшение ---------- */
 
-static HashSet *CreateHashSet(int capacity)
-{
-    HashSet *hs = (HashSet *)calloc(1, sizeof(HashSet));
-    if (!hs) return NULL;
-    hs->states = (PackedState *)malloc(sizeof(PackedState) * capacity);
-    hs->occupied = (char *)calloc(capacity, sizeof(char));
-    hs->capacity = capacity;
-    hs->mask = capacity - 1;
-    if (!hs->states || !hs->occupied)
-    {
-        free(hs->states);
-        free(hs->occupied);
-        free(hs);
-        return NULL;
-    }
-    return hs;
-}
+#define ANYTIME_START_WEIGHT 5.0  // начальный вес, если opt->weight не задан
+#define ANYTIME_LAST_WEIGHT  1.1  // меньший вес сразу заменяется на 1 (оптимальный A*)
 
-static void FreeHashSet(HashSet *hs)
+/* AddStats — добавляет счётчики одного прогона к сумме по всем прогонам anytime. */
+static void AddStats(SolverStats *sum, const SolverStats *st)
 {
-    if (!hs) return;
-    free(hs->states);
-    free(hs->occupied);
-    free(hs);
+    sum->expanded += st->expanded;
+    sum->generated += st->generated;
+    sum->duplicates += st->duplicates;
+    sum->prune.freeze += st->prune.freeze;
+    sum->prune.corral += st->prune.corral;
+    sum->pruned_h += st->pruned_h;
+    if (st->open_peak > sum->open_peak) sum->open_peak = st->open_peak;
+    if (st->pool_peak > sum->pool_peak) sum->pool_peak = st->pool_peak;
+    sum->reallocs += st->reallocs;
+    sum->rehashes += st->rehashes;
+    if (st->bytes > sum->bytes) sum->bytes = st->bytes;
+    sum->pdb_ms += st->pdb_ms;
+    if (st->pdb_bytes > sum->pdb_bytes) sum->pdb_bytes = st->pdb_bytes;
+    sum->init_ms += st->init_ms;
+    sum->search_ms += st->search_ms;
+    sum->path_ms += st->path_ms;
 }
 
 /*
- * HashSetGrow — удваивает ёмкость таблицы и перехеширует все записи.
- * Вызывается автоматически при заполнении >50% (load factor 0.5),
- * чтобы сохранить скорость линейного зондирования.
+ * RunAnytime — режим SOLVER_ANYTIME: взвешенный A* перезапускается с
+ * убывающим весом (5, 3, 2, 1.5, 1.25, 1.125, 1). Первый прогон с большим
+ * весом быстро находит какое-то решение, каждый следующий ищет только
+ * решения короче лучшего (cutoff) и потому раскрывает меньше. О каждом
+ * решении печатается строка [solver] с длиной и нижней границей
+ * оптимума, то же публикуется в progress (best_pushes, lower_bound).
+ *
+ * Поиск заканчивается, когда оптимальность доказана: прогон с весом 1
+ * нашёл решение или прогон с отсечением по лучшему решению опустошил
+ * open list. При исчерпании лимитов opt возвращается лучшее найденное
+ * решение (SOLVE_FOUND); отмена выбрасывает и его. Анализ уровня и база
+ * образцов строятся один раз на все прогоны — если opt->memo не задан,
+ * через временный SolverMemo.
  */
-static int HashSetGrow(HashSet *hs, int nb)
+static SolveResult RunAnytime(const Level *level, Solver *solver, const SolverOptions *opt,
+                              SolverStats *stats)
 {
-    int new_cap = hs->capacity * 2;
-    PackedState *new_states = (PackedState *)malloc(sizeof(PackedState) * new_cap);
-    char *new_occ = (char *)calloc(new_cap, sizeof(char));
-    if (!new_states || !new_occ)
-    {
-        free(new_states);
-        free(new_occ);
-        return 0;
-    }
-    int new_mask = new_cap - 1;
-    // Перенос всех существующих записей в новую таблицу
-    for (int i = 0; i < hs->capacity; i++)
+    SolverMemo local = {0};
+    SolverOptions run = *opt;
+    if (!run.memo) run.memo = &local;
+    double t_start = NowMs();
+    double weight = opt->weight > 1.0 ? opt->weight : ANYTIME_START_WEIGHT;
+    SolverStats sum = {0};
+    Solver best = {0};
+    SolveResult result;
+
+    for (;;)
     {
-        if (!hs->occupied[i]) continue;
-        uint32_t idx = HashPacked(&hs->states[i], nb) & new_mask;
-        while (new_occ[idx])
+        if (opt->time_limit_ms > 0)
         {
-            idx = (idx + 1) & new_mask; // линейное зондирование
+            run.time_limit_ms = opt->time_limit_ms - (NowMs() - t_start);
+            if (run.time_limit_ms <= 0) { result = SOLVE_BUDGET; break; }
         }
-        new_states[idx] = hs->states[i];
-        new_occ[idx] = 1;
+        if (weight < ANYTIME_LAST_WEIGHT) weight = 1.0;
+        run.weight = weight;
+
+        Solver cur = {0};
+        SolverStats st;
+        result = RunAStar(level, &cur, &run, &st, sum.pushes);
+        AddStats(&sum, &st);
+        if (st.lower_bound > sum.lower_bound) sum.lower_bound = st.lower_bound;
+        if (result != SOLVE_FOUND) break;
+
+        FreeSolver(&best);
+        best = cur;
+        sum.solutions++;
+        sum.pushes = st.pushes;
+        printf("[solver] anytime w=%.2f  pushes=%d  bound=%d  ms=%.1f\n",
+               weight, sum.pushes, sum.lower_bound, NowMs() - t_start);
+        if (opt->progress)
+        {
+            atomic_store(&opt->progress->best_pushes, sum.pushes);
+            atomic_store(&opt->progress->lower_bound, sum.lower_bound);
+        }
+        if (sum.lower_bound >= sum.pushes) break; // оптимально
+        weight = 1.0 + (weight - 1.0) / 2;
     }
 
-    free(hs->states);
-    free(hs->occupied);
-    hs->states = new_states;
-    hs->occupied = new_occ;
-    hs->capacity = new_cap;
-    hs->mask = new_mask;
-    return 1;
-}
-
-/*
- * HashSetInsert — пытается вставить состояние ps в таблицу.
- * Возвращает 1, если состояние новое (вставлено).
- * Возвращает 0, если состояние уже присутствует (дубликат).
- *
- * Линейное зондирование: если ячейка занята другим состоянием,
- * переходим к следующей по кругу (idx+1) & mask.
- */
-static int HashSetInsert(HashSet *hs, const PackedState *ps, int nb)
-{
-    if (hs->count * 2 >= hs->capacity) // load factor > 0.5
+    // Open list опустел под отсечением: короче лучшего решений нет
+    if (result == SOLVE_UNSOLVABLE && sum.pushes > 0)
     {
-        if (!HashSetGrow(hs, nb)) return 0;
+        sum.lower_bound = sum.pushes;
+        if (opt->progress) atomic_store(&opt->progress->lower_bound, sum.lower_bound);
     }
-
-    uint32_t idx = HashPacked(ps, nb) & hs->mask;
-    while (hs->occupied[idx])
+    if (sum.pushes > 0 && result != SOLVE_CANCELLED)
+    {
+        result = SOLVE_FOUND;
+        *solver = best;
+    }
+    else
     {
-        if (PackedEqual(&hs->states[idx], ps, nb)) return 0; // уже есть
-        idx = (idx + 1) & hs->mask;
+        FreeSolver(&best);
+        sum.pushes = 0;
     }
-    hs->states[idx] = *ps;
-    hs->occupied[idx] = 1;
-    hs->count++;
-    return 1;
+    if (stats) *stats = sum;
+    FreeSolverMemo(&local);
+    return result;
 }
 
-/* ---------- Главная функция: A* поиск решения ---------- */
-
 /*
- * SolveLevel — запускает A* поиск от начального состояния уровня.
+ * SolveLevelEx — единая точка входа решателя: режим, лимиты времени,
+ * раскрытий и памяти, прогресс и отмена — в options (NULL — A* с
+ * лимитами по умолчанию), счётчики — в stats (может быть NULL).
  *
- * Возвращает true и заполняет solver->moves последовательностью
- * направлений (индексы 0..3 = вверх/вниз/влево/вправо), если решение
- * найдено. Иначе возвращает false.
+ * Решается текущая позиция level (ящики и игрок). Если в options->memo
+ * есть решение, на цепочке которого лежит эта позиция, ходы строятся по
+ * нему без поиска (режимам, обязанным найти оптимум, — только если
+ * цепочка оптимальна); иначе поиск переиспользует анализ уровня из memo.
+ * Вес options->weight учитывают только A* и anytime; остальные режимы
+ * всегда ищут оптимальное решение.
  *
- * Общая схема A*:
- *   1. Создать начальный узел, поместить в open list (MinHeap).
- *   2. Пока open list не пуст:
- *      a. Извлечь узел cur с наименьшим f = g + h.
- *      b. Если cur — целевое состояние (все ящики на целях) — путь найден.
- *      c. Для каждого из 4 направлений попробовать сделать шаг:
- *         - Если новая клетка — стена, пропустить.
- *         - Если новая клетка — ящик, попробовать толкнуть его дальше;
- *           если ящик упирается в стену или другой ящик — пропустить.
- *         - Если после толчка возник дедлок — пропустить.
- *         - Если новое состояние уже в closed list — пропустить.
- *         - Иначе создать дочерний узел и добавить в open list.
- *   3. Если путь найден, восстановить его, идя по цепочке parent.
+ * Возвращает SOLVE_FOUND и ходы в solver либо причину, по которой
+ * решения нет: уровень нерешаем, кончился бюджет, не хватило памяти или
+ * поиск отменён.
  */
-bool SolveLevel(const Level *level, Solver *solver)
+SolveResult SolveLevelEx(const Level *level, Solver *solver, const SolverOptions *options,
+                         SolverStats *stats)
 {
-    int nb = level->num_boxes;
-    bool success = false;
-
-    // Инициализация трёх структур данных
-    NodePool *pool  = CreateNodePool(NODES_INIT_CAP);
-    MinHeap  *open  = CreateHeap(HEAP_INIT_CAP);
-    HashSet  *closed = CreateHashSet(HASH_INIT_CAP);
-
-    if (!pool || !open || !closed)
-        goto cleanup;
-
-    // Кодируем цели в uint16_t и сортируем для сравнения с состояниями
-    uint16_t goals[MAX_BOXES];
-    for (int i = 0; i < nb; i++)
-        goals[i] = (uint16_t)(level->goals[i].y * MAX_FIELD + level->goals[i].x);
-    SortBoxes(goals, nb);
-
-    // Создаём корневой узел (начальное состояние)
-    {
-        AStarNode root;
-        root.state.player = (uint16_t)(level->player.y * MAX_FIELD + level->player.x);
-        for (int i = 0; i < nb; i++)
-            root.state.boxes[i] = (uint16_t)(level->boxes[i].y * MAX_FIELD + level->boxes[i].x);
-        SortBoxes(root.state.boxes, nb); // нормализуем порядок ящиков
-        root.parent = -1;      // корень не имеет родителя
-        root.direction = -1;   // корень не имеет направления
-        root.g = 0;            // стоимость пути от старта = 0
-        root.f = Heuristic(root.state.boxes, goals, nb); // f = g + h = 0 + h
-
-        int root_idx = PoolAdd(pool, &root);
-        if (root_idx < 0) goto cleanup;
-        HeapPush(open, pool, root_idx);
-        HashSetInsert(closed, &root.state, nb); // сразу помечаем как посещённый
-    }
-
-    int found = -1;      // индекс найденного целевого узла (-1 = не найден)
-    int iterations = 0;
-
-    // Главный цикл A*
-    while (open->size > 0 && iterations < MAX_ITERATIONS)
+    SolverOptions defaults = {0};
+    const SolverOptions *opt = options ? options : &defaults;
+    SolverStats local = {0};
+    SolverStats *st = stats ? stats : &local;
+
+    bool need_optimal = opt->algorithm != SOLVER_ANYTIME &&
+                        !(opt->algorithm == SOLVER_ASTAR && opt->weight > 1);
+    int pushes = 0;
+    if (opt->memo && SolveFromMemo(level, opt->memo, need_optimal, solver, &pushes))
     {
-        iterations++;
-
-        // Извлекаем узел с наименьшим f из open list
-        int cur_idx = HeapPop(open, pool);
-        if (cur_idx < 0) break;
-
-        /*
-         * Копируем данные текущего узла на стек.
-         * Это критически важно: PoolAdd внутри цикла может вызвать realloc,
-         * после чего pool->data укажет на новый адрес, а старые указатели
-         * на элементы массива станут невалидными. Работая с локальными
-         * копиями cur_state и cur_g, мы избегаем use-after-realloc.
-         */
-        PackedState cur_state = pool->data[cur_idx].state;
-        int cur_g = pool->data[cur_idx].g;
-
-        // Проверка победы: все ящики совпадают с отсортированными целями
-        int won = 1;
-        for (int i = 0; i < nb; i++)
-            if (cur_state.boxes[i] != goals[i]) { won = 0; break; }
-        if (won) { found = cur_idx; break; }
-
-        // Текущая позиция игрока
-        int px = cur_state.player % MAX_FIELD;
-        int py = cur_state.player / MAX_FIELD;
-
-        // Раскрытие узла: пробуем все 4 направления
-        for (int d = 0; d < 4; d++)
-        {
-            int nx = px + SDX[d]; // куда шагает игрок
-            int ny = py + SDY[d];
-
-            // Проверяем границы и стены
-            if (nx < 0 || nx >= level->width || ny < 0 || ny >= level->height) continue;
-            if (level->cells[ny][nx] == CELL_WALL) continue;
-
-            uint16_t npos = (uint16_t)(ny * MAX_FIELD + nx); // новая позиция игрока
-
-            // Копируем ящики из локальной копии состояния (а не из pool->data!)
-            uint16_t new_boxes[MAX_BOXES];
-            memcpy(new_boxes, cur_state.boxes, sizeof(uint16_t) * nb);
-
-            int box_idx = IsBoxAt(new_boxes, nb, npos);
-
-            if (box_idx != -1) // на пути ящик — пытаемся его толкнуть
-            {
-                int bnx = nx + SDX[d]; // куда полетит ящик
-                int bny = ny + SDY[d];
-                if (bnx < 0 || bnx >= level->width || bny < 0 || bny >= level->height) continue;
-                if (level->cells[bny][bnx] == CELL_WALL) continue; // ящик упёрся в стену
-                uint16_t bpos = (uint16_t)(bny * MAX_FIELD + bnx);
-                if (IsBoxAt(new_boxes, nb, bpos) != -1) continue; // ящик упёрся в другой ящик
-
-                new_boxes[box_idx] = bpos; // перемещаем ящик
-            }
-
-            // Отсекаем дедлоки: если после толчка возник тупик — пропускаем
-            if (box_idx != -1 && IsDeadState(level, new_boxes, nb, goals))
-                continue;
-
-            // Нормализуем порядок ящиков для однозначного представления состояния
-            SortBoxes(new_boxes, nb);
-
-            // Формируем новое состояние
-            PackedState ns;
-            ns.player = npos;
-            memcpy(ns.boxes, new_boxes, sizeof(uint16_t) * nb);
-
-            // Проверяем, посещали ли мы это состояние раньше
-            if (!HashSetInsert(closed, &ns, nb))
-                continue; // уже в closed list — пропускаем
-
-            // Создаём дочерний узел: g увеличивается на 1 (один ход),
-            // f = g + h(нового состояния)
-            AStarNode child;
-            child.state = ns;
-            child.parent = cur_idx;  // ссылка на родителя для восстановления пути
-            child.direction = d;     // направление, которым был сделан этот ход
-            child.g = cur_g + 1;
-            child.f = child.g + Heuristic(new_boxes, goals, nb);
-
-            int child_idx = PoolAdd(pool, &child);
-            if (child_idx < 0) goto done; // закончилась память
-
-            if (!HeapPush(open, pool, child_idx))
-                goto done;
-        }
+        *st = (SolverStats){0};
+        st->pushes = pushes;
+        st->lower_bound = opt->memo->optimal ? pushes : 0;
+        st->solutions = 1;
+        return SOLVE_FOUND;
     }
 
-done:
-    if (found >= 0)
+    SolveResult result;
+    switch (opt->algorithm)
     {
-        /*
-         * Восстановление пути от финального узла до корня.
-         *
-         * Идём по цепочке parent-указателей, считаем длину пути,
-         * затем заполняем массив moves в обратном порядке (от старта к финишу).
-         */
-
-        // Первый проход: считаем длину пути
-        int path_len = 0;
-        int idx = found;
-        while (idx > 0) // корень имеет parent = -1, его не считаем
-        {
-            path_len++;
-            idx = pool->data[idx].parent;
-        }
-
-        solver->moves = (int *)malloc(sizeof(int) * path_len);
-        if (solver->moves)
-        {
-            solver->num_moves = path_len;
-            solver->current_move = 0;
-            solver->active = true;
-            solver->timer = 0;
-
-            // Второй проход: заполняем moves с конца к началу
-            idx = found;
-            for (int i = path_len - 1; i >= 0; i--)
-            {
-                solver->moves[i] = pool->data[idx].direction;
-                idx = pool->data[idx].parent;
-            }
-            success = true;
-        }
+    case SOLVER_IDA:     result = RunIDA(level, solver, opt, st); break;
+    case SOLVER_HDA:     result = RunHDA(level, solver, opt, st); break;
+    case SOLVER_BIDIR:   result = RunBidirectional(level, solver, opt, st); break;
+    case SOLVER_ANYTIME: result = RunAnytime(level, solver, opt, st); break;
+    case SOLVER_ASTAR:
+    default:             result = RunAStar(level, solver, opt, st, 0); break;
     }
 
-    printf("[solver] iterations=%d  pool=%d  hash=%d  found=%s\n",
-           iterations, pool->count, closed->count,
-           found >= 0 ? "YES" : "NO");
+    // Цепочку в memo записал BuildMoves; оптимальность известна только здесь
+    if (opt->memo && result == SOLVE_FOUND)
+        opt->memo->optimal = st->lower_bound >= st->pushes;
+    return result;
+}
 
-cleanup:
-    FreeNodePool(pool);
-    FreeHeap(open);
-    FreeHashSet(closed);
-    return success;
+/* SolveLevel — A* без дополнительных лимитов; true, если решение найдено. */
+bool SolveLevel(const Level *level, Solver *solver)
+{
+    return SolveLevelEx(level, solver, NULL, NULL) == SOLVE_FOUND;
 }
 
 /* FreeSolver — освобождает память, выделенную под массив ходов. */
@@ -703,3 +436,16 @@ void FreeSolver(Solver *solver)
     solver->current_move = 0;
     solver->active = false;
 }
+
+/* FreeSolverMemo — освобождает сохранённое решение и базу образцов; анализ уровня тоже забывается. */
+void FreeSolverMemo(SolverMemo *memo)
+{
+    FreePatternDB(&memo->ctx.pdb);
+    free(memo->path);
+    free(memo->dirs);
+    memo->path = NULL;
+    memo->dirs = NULL;
+    memo->num_pushes = 0;
+    memo->optimal = false;
+    memo->valid = false;
+}
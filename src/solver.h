@@ -3,7 +3,13 @@
 
 #include "types.h"
 
+SolveResult SolveLevelEx(const Level *level, Solver *solver, const SolverOptions *options,
+                         SolverStats *stats);
 bool SolveLevel(const Level *level, Solver *solver);
+bool SolveLevelIDA(const Level *level, Solver *solver);
+bool SolveLevelParallel(const Level *level, Solver *solver, int threads);
+bool SolveLevelBidirectional(const Level *level, Solver *solver);
 void FreeSolver(Solver *solver);
+void FreeSolverMemo(SolverMemo *memo);
 
-#endif
\ No newline at end of file
+#endif
@@ -3,7 +3,11 @@
 
 #define MAX_BOXES 10
 #define MAX_FIELD 20
+#define LEVEL_SOLUTION_MAX 1024 // ходов в готовом решении уровня (Level.solution)
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 typedef enum
 {
@@ -85,46 +89,149 @@ typedef struct
     float timer;
 } Solver;
 
+// прогресс решателя: пишет поток поиска, читает UI (SolveJob)
+typedef struct
+{
+    atomic_llong expanded;   // раскрыто состояний
+    atomic_int frontier;     // размер фронта: open list A* или глубина стека IDA*
+    atomic_int f_bound;      // текущее f: верх open list A* или порог итерации IDA*
+    atomic_bool cancel;      // выставляет UI — поиск прерывается при следующей проверке
+    atomic_int best_pushes;  // anytime: толчков в лучшем найденном решении, 0 — пока нет
+    atomic_int lower_bound;  // anytime: оптимум не короче стольких толчков
+} SolverProgress;
+
+// player — канонический представитель области достижимости игрока
 typedef struct
 {
     unsigned short player;
     unsigned short boxes[MAX_BOXES];
 } PackedState;
 
-// узел A*
+// узел A* (один толчок ящика); само состояние восстанавливается из
+// точного ключа или лежит в NodePool.states (см. NodeState в search.c)
 typedef struct
 {
-    PackedState state;
+    uint64_t key;    // ранг состояния или ключ Zobrist (SearchContext.ranks.exact)
     int parent;      // индекс родителя в пуле (-1 для корня)
-    int direction;   // направление хода (0-3), -1 для корня
-    int g;           // стоимость пути от старта
-    int f;           // g + h (приоритет в куче)
+    int g;           // число толчков от старта
+    int f;           // g + h (корзина в open list)
+    unsigned short parent_owner; // поток, в пуле которого лежит родитель (HDA*; в A* — 0)
+    signed char direction; // направление толчка (0-3), -1 для корня
+    unsigned char side;    // двунаправленный поиск: 0 — от старта, 1 — от целей
 } AStarNode;
 
-// пул узлов (динамический массив, растёт ×2)
+// пул узлов: блоки по POOL_CHUNK узлов (nodes.h), узлы никогда не переезжают
 typedef struct
 {
-    AStarNode *data;
+    AStarNode **chunks;   // chunks[i] — узлы i * POOL_CHUNK ...
+    PackedState **states; // состояния узлов теми же блоками; NULL, если ключи точные
     int count;
-    int capacity;
+    int num_chunks;       // выделено блоков
+    int max_chunks;       // длина таблиц блоков (по лимиту узлов)
+    long long bytes;
 } NodePool;
 
-// бинарная мин-куча по f (приоритетная очередь)
+// стек индексов узлов NodePool с одинаковыми f и g
 typedef struct
 {
-    int *idx;       // индексы в NodePool
+    int *idx;
     int size;
     int capacity;
-} MinHeap;
+} IndexStack;
+
+// корзина open list: узлы с одним f, разложенные по g
+typedef struct
+{
+    IndexStack *by_g;   // by_g[g] — узлы с этим g
+    int num_g;          // выделено стеков
+    int top_g;          // наибольшее g, где ещё могут быть узлы
+    int count;
+} FBucket;
+
+// очередь с приоритетами по корзинам f (open list A*)
+typedef struct
+{
+    FBucket *buckets;   // buckets[f]
+    int num_buckets;
+    int min_f;          // наименьшее f, где ещё могут быть узлы
+    int size;
+    int reallocs;       // рост массивов корзин и стеков
+    long long bytes;
+} BucketQueue;
+
+#define PUSH_DIST_INF 0xffff
+#define CELL_WORDS ((MAX_FIELD * MAX_FIELD + 63) / 64) // 64-битных слов на битовую карту поля
+
+// битовая карта поля: бит pos = y * MAX_FIELD + x (операции — bitboard.h)
+typedef struct
+{
+    uint64_t w[CELL_WORDS];
+} Bitboard;
+
+// битовые маски уровня для горячего цикла решателя
+typedef struct
+{
+    Bitboard floor;          // клетки пола в пределах уровня
+    Bitboard goals;
+    Bitboard box_ok;         // пол без мёртвых клеток — куда можно толкать ящик
+    Bitboard not_first_col;  // все клетки, кроме x = 0
+    Bitboard not_last_col;   // все клетки, кроме x = MAX_FIELD - 1
+} BoardMasks;
+
+// предрасчёт по уровню: расстояния в толчках от каждой клетки до каждой цели
+// (по пустому уровню) и мёртвые клетки
+typedef struct
+{
+    int num_goals;
+    unsigned short dist[MAX_BOXES][MAX_FIELD * MAX_FIELD]; // PUSH_DIST_INF — цель недостижима
+    Bitboard dead;                                         // бит pos — ящик с клетки не доедет до целей
+} PushTable;
+
+// случайные 64-битные ключи Zobrist: ящик / игрок в каждой клетке
+typedef struct
+{
+    uint64_t box[MAX_FIELD * MAX_FIELD];
+    uint64_t player[MAX_FIELD * MAX_FIELD];
+} ZobristKeys;
+
+// точные ключи состояний (search.c): номер набора клеток ящиков в
+// комбинаторной системе счисления и номер клетки игрока
+typedef struct
+{
+    bool fits;               // все расстановки уровня умещаются в 64 бита
+    bool exact;              // fits и все ящики корня на живых клетках
+    int num_cells;           // клеток, где может стоять ящик (пол без мёртвых)
+    int num_players;         // клеток пола — возможных позиций игрока
+    short cell_index[MAX_FIELD * MAX_FIELD];   // номер клетки ящика, -1 — мёртвая/стена
+    short player_index[MAX_FIELD * MAX_FIELD]; // номер клетки пола, -1 — стена
+    unsigned short cells[MAX_FIELD * MAX_FIELD];   // клетка по номеру ящика
+    unsigned short players[MAX_FIELD * MAX_FIELD]; // клетка по номеру игрока
+    uint64_t binom[MAX_FIELD * MAX_FIELD + 1][MAX_BOXES + 1]; // binom[n][k] = C(n, k)
+} StateRanks;
+
+#define PDB_MAX_SET 3 // наибольший набор ящиков в базе образцов
 
-// хеш-таблица с открытой адресацией (PackedState)
+// база образцов уровня (pdb.c): точное число толчков, за которое набор из
+// k ящиков (2..PDB_MAX_SET) без остальных встаёт на цели
 typedef struct
 {
-    PackedState *states;
-    char *occupied;
+    int max_set;                          // наибольший построенный k, 0 — базы нет
+    uint8_t *cost[PDB_MAX_SET + 1];       // cost[k][ранг набора * num_players + номер клетки игрока]
+    long long bytes;                      // память таблиц
+    double build_ms;                      // время построения, 0 — взята из SolverMemo
+    bool built;                           // BuildPatternDB вызывалась (таблиц может не быть)
+} PatternDB;
+
+// хеш-таблица с открытой адресацией: состояние -> индекс узла в NodePool
+typedef struct
+{
+    uint64_t *keys; // ключи записей, HASH_EMPTY — пустая ячейка
+    int *nodes;      // индексы узлов (читаются только для занятых ячеек)
     int capacity;
     int mask;        // capacity - 1
     int count;
+    int rehashes;    // сколько раз таблица удваивалась
+    long long bytes;
 } HashSet;
 
 typedef struct
@@ -142,6 +249,324 @@ typedef struct
     UndoNode *undo_head;
     int undo_count;
     GameState initial_state;
+    uint64_t seed;           // зерно генератора: GenerateLevelSeeded(difficulty, seed, options) строит этот же уровень
+    // цена решения, известная после генерации (GenerateOptions); иначе — нули
+    int solve_pushes;        // толчков в оптимальном решении; 0 — не решён в бюджет
+    long long solve_expanded;// раскрыто состояний A* (GEN_REVERSE_BFS — состояний обхода)
+    double solve_ms;
+    int solve_rejected;      // кандидатов отброшено до этого уровня
+    // готовое решение от генератора (GEN_REVERSE_BFS): ходы 0-3 от initial_state
+    uint8_t solution[LEVEL_SOLUTION_MAX];
+    int solution_len;        // 0 — решения нет
 } Level;
 
+// способ генерации уровня
+typedef enum
+{
+    GEN_RANDOM_PULLS,        // случайные притягивания от целей (ReverseSolve)
+    GEN_REVERSE_BFS          // обход в ширину притягиваниями: самое далёкое состояние и его решение
+} GenerateMode;
+
+// параметры генерации; нулевые поля — значения по умолчанию. Бюджет
+// решения: кандидат, который A* не решает в эти рамки, отбрасывается
+// (max_nodes и time_limit_ms оба нули — без проверки; уровню с готовым
+// решением проверка не нужна)
+typedef struct
+{
+    GenerateMode mode;
+    int max_states;          // GEN_REVERSE_BFS: состояний в обходе, 0 — LEVEL_BFS_STATES
+    long long max_nodes;     // раскрытий; от машины не зависит, уровень из зерна повторяется
+    double time_limit_ms;    // от машины зависит: с ним зерно уровень уже не повторяет
+    int max_tries;           // кандидатов до отказа, 0 — LEVEL_BUDGET_TRIES
+} GenerateOptions;
+
+// состояние ГПСЧ генератора уровней (xoshiro256**, level.c)
+typedef struct
+{
+    uint64_t s[4];
+} LevelRng;
+
+// пакетная генерация (GenerateLevels): потоки разбирают номера по счётчику
+typedef struct
+{
+    Difficulty difficulty;
+    Level *out;              // массив вызывающего на count уровней
+    int count;
+    uint64_t first_seed;     // уровень i строится из зерна first_seed + i
+    const GenerateOptions *options; // может быть NULL
+    atomic_int next;         // следующий неразобранный номер
+} LevelBatch;
+
+// поток пакетной генерации: своё состояние ГПСЧ, rand() не используется
+typedef struct
+{
+    LevelBatch *batch;
+    LevelRng rng;
+} LevelWorker;
+
+// режим решателя для SolveLevelEx
+typedef enum
+{
+    SOLVER_ASTAR,       // A* (solver.c)
+    SOLVER_IDA,         // IDA* с фиксированной памятью (ida.c)
+    SOLVER_HDA,         // многопоточный HDA* (hda.c)
+    SOLVER_BIDIR,       // двунаправленный поиск (bidir.c)
+    SOLVER_ANYTIME      // A* с убывающим весом: быстрое первое решение, затем улучшения (solver.c)
+} SolverAlgorithm;
+
+// итог SolveLevelEx
+typedef enum
+{
+    SOLVE_FOUND,        // решение в solver->moves
+    SOLVE_UNSOLVABLE,   // пространство исчерпано: решения нет
+    SOLVE_BUDGET,       // кончилось время или лимит раскрытий
+    SOLVE_OUT_OF_MEMORY,// лимит памяти или отказ malloc
+    SOLVE_CANCELLED     // отменён через progress->cancel
+} SolveResult;
+
+// параметры SolveLevelEx; нулевые поля — значения по умолчанию
+typedef struct
+{
+    SolverAlgorithm algorithm;
+    int threads;              // HDA*: число потоков, <= 0 — по числу ядер
+    double weight;            // A*: f = g + weight * h, решение не длиннее weight * оптимум;
+                              // <= 1 — оптимальный A*; anytime: начальный вес
+    double time_limit_ms;     // время на поиск, 0 — без ограничения
+    long long max_nodes;      // лимит раскрытий, 0 — встроенный лимит режима
+    long long max_bytes;      // лимит памяти пула, open и closed list и базы образцов,
+                              // 0 — без ограничения
+    SolverProgress *progress; // прогресс и отмена, может быть NULL
+    struct SolverMemo *memo;  // анализ и последнее решение уровня между запусками, может быть NULL
+} SolverOptions;
+
+// лимиты одного запуска в абсолютных величинах (InitBudget, search.c)
+typedef struct
+{
+    double deadline;          // момент NowMs(), после которого поиск прекращается; 0 — без срока
+    long long max_nodes;
+    long long max_bytes;      // 0 — без ограничения
+    SolverProgress *progress;
+} SearchBudget;
+
+// предрасчёт по уровню, общий для всех режимов решателя (search.c)
+typedef struct
+{
+    const Level *level;
+    int num_boxes;
+    PushTable pt;
+    BoardMasks masks;
+    ZobristKeys zk;
+    StateRanks ranks;
+    PatternDB pdb;      // таблицы принадлежат memo, если он задан
+    PackedState root;   // начальное состояние: ящики отсортированы, игрок нормализован
+    uint64_t root_key;
+    struct SolverMemo *memo; // куда BuildMoves запоминает решение, может быть NULL
+} SearchContext;
+
+// память решателя между запусками на одном уровне (SolverOptions.memo):
+// анализ уровня не зависит от ящиков и игрока и строится один раз, а
+// цепочка толчков последнего решения позволяет продолжить его с любого
+// состояния на ней без поиска
+typedef struct SolverMemo
+{
+    bool valid;            // ctx заполнен для уровня с ключом level_key
+    uint64_t level_key;    // отпечаток стен и целей
+    SearchContext ctx;     // анализ уровня; корень и level не используются
+    PackedState *path;     // состояния последнего решения, path[0] — его корень
+    int *dirs;             // dirs[k] — толчок, ведущий в path[k]
+    int num_pushes;
+    bool optimal;          // цепочка оптимальна (lower_bound == pushes); иначе её
+                           // берут только режимы, которым оптимум не обязателен
+} SolverMemo;
+
+// счётчики отсечений при раскрытии состояний (ExpandState)
+typedef struct
+{
+    long long freeze;   // толчок заморозил ящик вне цели (2×2 и цепочки)
+    long long corral;   // толчки, отброшенные из-за PI-корраля
+} PruneStats;
+
+// счётчики одного запуска решателя; заполняются, если вызывающий передал
+// структуру (SolveLevelEx(..., stats))
+typedef struct
+{
+    long long expanded;     // раскрыто состояний
+    long long generated;    // потомков от ExpandState (после обрезки дедлоков)
+    long long duplicates;   // отброшено как уже встреченные (HashSet / таблица транспозиций IDA*)
+    PruneStats prune;       // отсечено при раскрытии
+    long long pruned_h;     // отсечено эвристикой: ящики не развести по целям
+    long long open_peak;    // наибольший open list (в IDA* — глубина стека)
+    long long pool_peak;    // узлов в пуле к концу поиска
+    long long reallocs;     // шаги роста: блоки пула и массивы open list
+    long long rehashes;     // удвоения HashSet
+    long long bytes;        // выделено под пул, open и closed list (пик)
+    int solutions;          // найдено решений (anytime — каждое улучшение)
+    int pushes;             // толчков в итоговом решении
+    int lower_bound;        // оптимум не короче; равно pushes, если оптимальность доказана
+    double pdb_ms;          // построение базы образцов (входит в init_ms), 0 — не строилась
+    long long pdb_bytes;    // память базы образцов
+    double init_ms;         // выделение структур и предрасчёт уровня (InitSearch)
+    double search_ms;       // сам поиск
+    double path_ms;         // восстановление шагов игрока
+} SolverStats;
+
+// параметры OptimizeSolution (optimize.c); нулевые поля — значения по умолчанию
+typedef struct
+{
+    int window;               // толчков в окне перебора, <= 0 — OPTIMIZE_WINDOW
+    long long max_nodes;      // раскрытий на одно окно, 0 — OPTIMIZE_WINDOW_NODES
+    double time_limit_ms;     // на всю оптимизацию, 0 — без ограничения
+    SolverProgress *progress; // только отмена (progress->cancel), может быть NULL
+    struct SolverMemo *memo;  // анализ уровня между запусками, может быть NULL
+} OptimizeOptions;
+
+// итог OptimizeSolution
+typedef struct
+{
+    int moves_before;       // шагов игрока во входном решении
+    int moves_after;        // шагов после оптимизации (не больше moves_before)
+    int pushes_before;
+    int pushes_after;
+    int walk_saved;         // шагов убрано перестройкой подходов к ящикам
+    int cycles;             // вырезано петель: состояние повторилось
+    int shortcuts;          // окон заменено более короткой цепочкой толчков
+    long long expanded;     // раскрыто состояний при переборе окон
+    double ms;
+} OptimizeStats;
+
+// решение в фоновом потоке (solve_job.c)
+typedef struct
+{
+    pthread_t thread;
+    Level level;             // копия уровня: игра не трогает её во время поиска
+    Solver solver;           // результат, забирается после завершения
+    SolverProgress progress;
+    SolverOptions options;   // options.progress указывает на progress
+    bool running;            // поток запущен и ещё не присоединён
+    SolveResult result;
+    SolverStats stats;       // счётчики поиска (раскрытые узлы и т.д.)
+    OptimizeStats optimize;  // укорачивание неоптимального решения после поиска
+    atomic_bool done;        // поток закончил поиск
+    double elapsed_ms;
+} SolveJob;
+
+#define LEVEL_QUEUE_DEPTH 3 // готовых уровней на сложность
+
+// счётчики очереди готовых уровней
+typedef struct
+{
+    long long hits;          // уровень взят из очереди сразу
+    long long misses;        // очередь была пуста: уровень строился на месте
+    long long generated;     // построено фоновым потоком
+    int ready[3];            // сейчас в очереди по сложностям
+} LevelQueueStats;
+
+// фоновая генерация уровней про запас (level_queue.c)
+typedef struct
+{
+    pthread_t thread;
+    pthread_mutex_t lock;    // защищает ready, count, last и stop
+    pthread_cond_t wake;     // уровень взят или пора останавливаться
+    Level ready[3][LEVEL_QUEUE_DEPTH]; // кольцо на сложность
+    int head[3];
+    int count[3];
+    Difficulty last;         // последняя взятая сложность — пополняется первой
+    bool stop;
+    bool running;            // поток запущен и ещё не присоединён
+    atomic_llong hits;
+    atomic_llong misses;
+    atomic_llong generated;
+} LevelQueue;
+
+#define MAX_CHILDREN (4 * MAX_BOXES) // толчков из одного состояния не больше
+
+// состояние после одного толчка (результат ExpandState)
+typedef struct
+{
+    PackedState state;
+    uint64_t key;
+    int direction;  // направление толчка (0-3)
+} SearchChild;
+
+// запись таблицы транспозиций IDA*: наименьшее g, с которым состояние
+// встречено на текущей итерации углубления
+typedef struct
+{
+    uint64_t key;
+    int g;
+    int iteration;
+} IdaEntry;
+
+// кадр стека обхода в глубину IDA*: состояние и его отсортированные по h
+// потомки, next — следующий непросмотренный потомок
+typedef struct
+{
+    PackedState state;
+    uint64_t key;
+    int direction;
+    int g;
+    int num_children;
+    int next;
+    SearchChild children[MAX_CHILDREN];
+    int h[MAX_CHILDREN];
+} IdaFrame;
+
+#define HDA_BATCH 64 // сообщений в одной пачке между потоками HDA*
+
+// сообщение HDA*: порождённое состояние, отправленное потоку-владельцу
+typedef struct
+{
+    uint64_t key;
+    PackedState state;
+    unsigned short parent_owner;
+    int parent;
+    int direction;
+    int g;
+} HdaMsg;
+
+// пачка сообщений — элемент очереди HdaQueue
+typedef struct HdaBatch
+{
+    _Atomic(struct HdaBatch *) next;
+    int count;
+    HdaMsg msgs[HDA_BATCH];
+} HdaBatch;
+
+// входящая очередь потока без блокировок: много писателей, один читатель
+typedef struct
+{
+    _Atomic(HdaBatch *) head;   // последняя добавленная пачка (пишут отправители)
+    HdaBatch stub;              // пустой элемент-заглушка
+    HdaBatch *tail;             // следующая пачка на чтение (только владелец)
+} HdaQueue;
+
+struct HdaShared;
+
+// поток HDA*: свои пул узлов, open/closed list и входящая очередь
+typedef struct
+{
+    HdaQueue inbox;
+    int id;
+    struct HdaShared *shared;
+    NodePool *pool;
+    BucketQueue *open;
+    HashSet *closed;
+    HdaBatch **outbox;   // outbox[t] — копящаяся пачка для потока t
+    int iterations;
+    SolverStats st;      // счётчики потока, суммируются после остановки
+} HdaWorker;
+
+// общее состояние HDA*
+typedef struct HdaShared
+{
+    const SearchContext *ctx;
+    HdaWorker *workers;
+    int num_threads;
+    atomic_int work;          // активные потоки + пачки в пути; 0 — поиск завершён
+    atomic_int abort;         // -1 — поиск идёт, иначе SolveResult причины остановки
+    _Atomic uint64_t best;    // лучшая цель: g << 40 | поток << 32 | индекс узла
+    SearchBudget budget;      // лимиты на один поток (раскрытия и память поделены)
+    atomic_llong expanded;    // раскрыто всеми потоками, для прогресса
+} HdaShared;
+
 #endif
\ No newline at end of file
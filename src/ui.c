@@ -1,32 +1,11 @@
 #include "ui.h"
 #include "raylib.h"
 #include "level.h"
+#include "level_queue.h"
 #include "game.h"
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
-#include <time.h>
-
-static const char *s_diff_names[] = {"easy", "medium", "hard"};
-
-static Level GenerateLevelTimed(Difficulty d)
-{
-    struct timespec t0, t1;
-    clock_gettime(CLOCK_MONOTONIC, &t0);
-    Level lvl = GenerateLevel(d);
-    clock_gettime(CLOCK_MONOTONIC, &t1);
-    double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
-
-    static FILE *gen_log = NULL;
-    if (!gen_log) gen_log = fopen("../tests/test_gen.txt", "a");
-    if (gen_log)
-    {
-        fprintf(gen_log, "%s;%d;%.2f\n", s_diff_names[d], lvl.num_boxes, ms);
-        fflush(gen_log);
-    }
-
-    return lvl;
-}
 
 #define C_BG CLITERAL(Color){35, 45, 35, 255}
 #define C_PANEL CLITERAL(Color){45, 58, 42, 240}
@@ -111,7 +90,7 @@ void DrawMenu(Screen *screen, int *quit, const char *username)
     DrawText("v1.0", 10, sh - 22, 14, C_DIM);
 }
 
-void DrawDifficultySelect(Screen *screen, Difficulty *diff, Level *level)
+void DrawDifficultySelect(Screen *screen, Difficulty *diff, Level *level, LevelQueue *queue)
 {
     int sw = GetScreenWidth(), sh = GetScreenHeight();
     ClearBackground(C_BG);
@@ -144,7 +123,7 @@ void DrawDifficultySelect(Screen *screen, Difficulty *diff, Level *level)
         {
             *diff = (Difficulty)i;
             FreeUndoStack(level);        // освобождаем старый стек перед новым уровнем
-            *level = GenerateLevelTimed(*diff);
+            *level = TakeLevel(queue, *diff); // готовый уровень из фоновой очереди
             *screen = SCREEN_GAME;
         }
         DrawText(descs[i], bx + bw + 20, y + (bh - 18) / 2, 18, C_DIM);
@@ -210,7 +189,7 @@ void DrawPause(Screen *screen, Level *level, int user_id, Difficulty diff)
     }
 }
 
-void DrawWin(Screen *screen, Level *level, Difficulty diff)
+void DrawWin(Screen *screen, Level *level, Difficulty diff, LevelQueue *queue)
 {
     Rectangle p = Overlay(420, 400);
     int px = (int)p.x, py = (int)p.y, pw = 420;
@@ -233,7 +212,7 @@ void DrawWin(Screen *screen, Level *level, Difficulty diff)
     if (Button("PLAY AGAIN", bx, by, bw, bh))
     {
         FreeUndoStack(level);            // освобождаем перед новым уровнем
-        *level = GenerateLevelTimed(diff);
+        *level = TakeLevel(queue, diff);
         *screen = SCREEN_GAME;
     }
     if (Button("CHANGE DIFF", bx, by + bh + gap, bw, bh))
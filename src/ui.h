@@ -6,10 +6,10 @@
 #include "db.h"
 
 void DrawMenu(Screen *screen, int *quit, const char *username);
-void DrawDifficultySelect(Screen *screen, Difficulty *diff, Level *level);
+void DrawDifficultySelect(Screen *screen, Difficulty *diff, Level *level, LevelQueue *queue);
 void DrawSettings(Screen *screen);
 void DrawPause(Screen *screen, Level *level, int user_id, Difficulty diff);
-void DrawWin(Screen *screen, Level *level, Difficulty diff);
+void DrawWin(Screen *screen, Level *level, Difficulty diff, LevelQueue *queue);
 void DrawRules(Screen *screen);
 void DrawStats(Screen *screen, int user_id);
 void DrawLogin(Screen *screen, int *user_id, char *username);
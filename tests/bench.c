@@ -1,45 +1,154 @@
 #include "../src/level.h"
 #include "../src/solver.h"
 #include "../src/game.h"
+#include "../src/db.h"
+#include "../src/optimize.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 int main(int argc, char *argv[])
 {
     int n = 100;
     if (argc >= 2) n = atoi(argv[1]);
-
-    srand((unsigned)time(NULL));
+    // дальше — режим: "ida" — IDA* вместо A*, "hda [потоков]" —
+    // многопоточный HDA* (по умолчанию по числу ядер), "bidir" —
+    // двунаправленный поиск, "anytime" — A* с убывающим весом до
+    // доказанного оптимума или срока; --weight W — вес эвристики A*
+    // (у anytime — начальный); лимиты на уровень: --time-ms, --max-nodes,
+    // --max-mb; --cache файл.db — брать решения из таблицы solutions и
+    // сохранять новые, --verify — проверять взятые из кэша проигрыванием,
+    // --optimize — укорачивать каждое решение (OptimizeSolution),
+    // --gen-threads T — генерировать уровни сложности одним пакетом на T
+    // потоках (GenerateLevels; 0 — по числу ядер), gen_ms — среднее на уровень;
+    // --seed S — уровни из зёрен S .. S+n-1 (GenerateLevelSeeded) вместо
+    // часов: один и тот же корпус до и после изменения; --gen-nodes N —
+    // отбрасывать уровни, которые A* не решает за N раскрытий; --gen-bfs
+    // [S] — генератор обходом в ширину на S состояний (GEN_REVERSE_BFS):
+    // уровень приходит с оптимальным решением, gen_pushes — его толчки
+    SolverOptions opt = {0};
+    const char *cache_path = NULL;
+    bool verify = false;
+    bool optimize = false;
+    int gen_threads = -1;
+    bool seeded = false;
+    uint64_t first_seed = 0;
+    GenerateOptions gen_options = {0};
+    for (int a = 2; a < argc; a++)
+    {
+        if (strcmp(argv[a], "ida") == 0) opt.algorithm = SOLVER_IDA;
+        else if (strcmp(argv[a], "bidir") == 0) opt.algorithm = SOLVER_BIDIR;
+        else if (strcmp(argv[a], "anytime") == 0) opt.algorithm = SOLVER_ANYTIME;
+        else if (strcmp(argv[a], "hda") == 0)
+        {
+            opt.algorithm = SOLVER_HDA;
+            if (a + 1 < argc && argv[a + 1][0] != '-') opt.threads = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--weight") == 0 && a + 1 < argc) opt.weight = atof(argv[++a]);
+        else if (strcmp(argv[a], "--time-ms") == 0 && a + 1 < argc) opt.time_limit_ms = atof(argv[++a]);
+        else if (strcmp(argv[a], "--max-nodes") == 0 && a + 1 < argc) opt.max_nodes = atoll(argv[++a]);
+        else if (strcmp(argv[a], "--max-mb") == 0 && a + 1 < argc) opt.max_bytes = atoll(argv[++a]) << 20;
+        else if (strcmp(argv[a], "--cache") == 0 && a + 1 < argc) cache_path = argv[++a];
+        else if (strcmp(argv[a], "--verify") == 0) verify = true;
+        else if (strcmp(argv[a], "--optimize") == 0) optimize = true;
+        else if (strcmp(argv[a], "--gen-threads") == 0 && a + 1 < argc) gen_threads = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc)
+        {
+            seeded = true;
+            first_seed = strtoull(argv[++a], NULL, 10);
+        }
+        else if (strcmp(argv[a], "--gen-nodes") == 0 && a + 1 < argc)
+            gen_options.max_nodes = atoll(argv[++a]);
+        else if (strcmp(argv[a], "--gen-bfs") == 0)
+        {
+            gen_options.mode = GEN_REVERSE_BFS;
+            if (a + 1 < argc && argv[a + 1][0] != '-') gen_options.max_states = atoi(argv[++a]);
+        }
+    }
+    if (cache_path && !db_open(cache_path)) return 1;
+    static const char *result_names[] = {"found", "unsolvable", "budget", "oom", "cancelled"};
 
     FILE *f = fopen("../tests/bench_results.csv", "w");
     if (!f) { fprintf(stderr, "cannot open bench_results.csv\n"); return 1; }
 
-    fprintf(f, "difficulty;num_boxes;gen_ms;solve_ms;solved\n");
+    fprintf(f, "difficulty;seed;num_boxes;gen_ms;gen_rejected;gen_solve_ms;gen_pushes;solve_ms;solved;result;cached;pushes;lower_bound;solutions;"
+               "moves;opt_moves;opt_pushes;opt_ms;"
+               "expanded;generated;duplicates;pruned_freeze;pruned_corral;pruned_h;"
+               "open_peak;pool_peak;reallocs;rehashes;mem_bytes;pdb_bytes;pdb_ms;init_ms;search_ms;path_ms\n");
 
     const char *diff_names[] = {"easy", "medium", "hard"};
 
+    Level *batch = gen_threads >= 0 && n > 0 ? (Level *)malloc(sizeof(Level) * n) : NULL;
+    if (gen_threads >= 0 && n > 0 && !batch) { fprintf(stderr, "out of memory\n"); return 1; }
+
     for (int d = 0; d < 3; d++)
     {
-        for (int i = 0; i < n; i++)
+        double batch_ms = 0;
+        if (batch)
         {
             struct timespec t0, t1;
-
             clock_gettime(CLOCK_MONOTONIC, &t0);
-            Level level = GenerateLevel((Difficulty)d);
+            if (seeded) GenerateLevelsSeeded((Difficulty)d, batch, n, first_seed, gen_threads, &gen_options);
+            else GenerateLevels((Difficulty)d, batch, n, gen_threads, &gen_options);
             clock_gettime(CLOCK_MONOTONIC, &t1);
-            double gen_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 +
-                            (t1.tv_nsec - t0.tv_nsec) / 1e6;
+            batch_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+            printf("[%s] %d levels in %.0f ms (%.0f levels/min)\n",
+                   diff_names[d], n, batch_ms, n * 60000.0 / (batch_ms > 0 ? batch_ms : 1));
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            struct timespec t0, t1;
+            Level level;
+            double gen_ms = batch_ms / n;
+            if (batch)
+                level = batch[i];
+            else
+            {
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                level = seeded ? GenerateLevelSeeded((Difficulty)d, first_seed + (uint64_t)i, &gen_options)
+                               : GenerateLevel((Difficulty)d, &gen_options);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                gen_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 +
+                         (t1.tv_nsec - t0.tv_nsec) / 1e6;
+            }
 
             Solver solver = {0};
+            SolverStats st = {0};
+            SolveResult res = SOLVE_FOUND;
+            uint64_t hash = cache_path ? level_fingerprint(&level) : 0;
             clock_gettime(CLOCK_MONOTONIC, &t0);
-            int solved = SolveLevel(&level, &solver);
+            int cached = cache_path && load_solution(hash, &solver, NULL, NULL);
+            if (cached && verify && !CheckSolution(&level, solver.moves, solver.num_moves))
+            {
+                FreeSolver(&solver);
+                cached = 0;
+            }
+            if (!cached) res = SolveLevelEx(&level, &solver, &opt, &st);
+            int solved = res == SOLVE_FOUND;
             clock_gettime(CLOCK_MONOTONIC, &t1);
             double solve_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 +
                               (t1.tv_nsec - t0.tv_nsec) / 1e6;
+            if (cache_path && solved && !cached) save_solution(hash, &solver, solve_ms, st.expanded);
+
+            int moves = solver.num_moves;
+            OptimizeStats os = {0};
+            if (optimize && solved)
+            {
+                OptimizeOptions oo = {0};
+                OptimizeSolution(&level, &solver, &oo, &os);
+            }
 
-            fprintf(f, "%s;%d;%.2f;%.2f;%d\n",
-                    diff_names[d], level.num_boxes, gen_ms, solve_ms, solved);
+            fprintf(f, "%s;%llu;%d;%.2f;%d;%.2f;%d;%.2f;%d;%s;%d;%d;%d;%d;%d;%d;%d;%.2f;"
+                       "%lld;%lld;%lld;%lld;%lld;%lld;%lld;%lld;%lld;%lld;%lld;%lld;%.2f;%.2f;%.2f;%.2f\n",
+                    diff_names[d], (unsigned long long)level.seed, level.num_boxes, gen_ms,
+                    level.solve_rejected, level.solve_ms, level.solve_pushes, solve_ms, solved, result_names[res], cached,
+                    st.pushes, st.lower_bound, st.solutions,
+                    moves, solver.num_moves, os.pushes_after, os.ms,
+                    st.expanded, st.generated, st.duplicates, st.prune.freeze, st.prune.corral,
+                    st.pruned_h, st.open_peak, st.pool_peak, st.reallocs, st.rehashes, st.bytes,
+                    st.pdb_bytes, st.pdb_ms, st.init_ms, st.search_ms, st.path_ms);
             fflush(f);
 
             if (solved) FreeSolver(&solver);
@@ -52,6 +161,8 @@ int main(int argc, char *argv[])
     }
 
     fclose(f);
+    free(batch);
+    if (cache_path) db_close();
     printf("Done -> bench_results.csv\n");
     return 0;
 }